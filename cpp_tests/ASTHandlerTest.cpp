@@ -2,6 +2,8 @@
 #include <R.h>
 #include <Rinternals.h>
 #include "../src/ASTHandler.hpp"
+#include "../src/RScanner.hpp"
+#include <algorithm>
 #include <memory>
 
 // Mock R symbols for testing
@@ -46,21 +48,15 @@ TEST_F(ASTHandlerTest, IsDeletable) {
     
     // Test when is_inside_block is false
     SEXP srcref = PROTECT(Rf_allocVector(INTSXP, 4));
-    std::vector<OperatorPos> ops = handler.gatherOperators(expr, srcref, false);
+    SiteTable ops = handler.gatherOperators(expr, srcref, false);
     // Verify the expression is not deletable when is_inside_block is false
     // This test assumes isDeletable returns _is_inside_block
-    EXPECT_EQ(0, std::count_if(ops.begin(), ops.end(), 
-                              [](const OperatorPos& pos) { 
-                                  return dynamic_cast<DeleteOperator*>(pos.op.get()) != nullptr; 
-                              }));
+    EXPECT_EQ(0, std::count(ops.kind.begin(), ops.kind.end(), OpKind::Delete));
     
     // Test when is_inside_block is true
     ops = handler.gatherOperators(expr, srcref, true);
     // Verify the expression is deletable when is_inside_block is true
-    EXPECT_GT(std::count_if(ops.begin(), ops.end(), 
-                           [](const OperatorPos& pos) { 
-                               return dynamic_cast<DeleteOperator*>(pos.op.get()) != nullptr; 
-                           }), 0);
+    EXPECT_GT(std::count(ops.kind.begin(), ops.kind.end(), OpKind::Delete), 0);
     
     UNPROTECT(2);
 }
@@ -77,11 +73,11 @@ TEST_F(ASTHandlerTest, GatherArithmeticOperators) {
     INTEGER(srcref)[2] = 1; // end line
     INTEGER(srcref)[3] = 10; // end col
     
-    std::vector<OperatorPos> ops = handler.gatherOperators(plus_expr, srcref, false);
+    SiteTable ops = handler.gatherOperators(plus_expr, srcref, false);
     
     // Verify we found the + operator
     ASSERT_GT(ops.size(), 0);
-    EXPECT_TRUE(dynamic_cast<PlusOperator*>(ops[0].op.get()) != nullptr);
+    EXPECT_EQ(OpKind::Plus, ops.kind[0]);
     
     UNPROTECT(1);
     
@@ -97,7 +93,7 @@ TEST_F(ASTHandlerTest, GatherArithmeticOperators) {
     
     // Verify we found the - operator
     ASSERT_GT(ops.size(), 0);
-    EXPECT_TRUE(dynamic_cast<MinusOperator*>(ops[0].op.get()) != nullptr);
+    EXPECT_EQ(OpKind::Minus, ops.kind[0]);
     
     UNPROTECT(1);
 }
@@ -114,11 +110,11 @@ TEST_F(ASTHandlerTest, GatherComparisonOperators) {
     INTEGER(srcref)[2] = 1;
     INTEGER(srcref)[3] = 10;
     
-    std::vector<OperatorPos> ops = handler.gatherOperators(eq_expr, srcref, false);
+    SiteTable ops = handler.gatherOperators(eq_expr, srcref, false);
     
     // Verify we found the == operator
     ASSERT_GT(ops.size(), 0);
-    EXPECT_TRUE(dynamic_cast<EqualOperator*>(ops[0].op.get()) != nullptr);
+    EXPECT_EQ(OpKind::Equal, ops.kind[0]);
     
     UNPROTECT(1);
     
@@ -134,7 +130,7 @@ TEST_F(ASTHandlerTest, GatherComparisonOperators) {
     
     // Verify we found the < operator
     ASSERT_GT(ops.size(), 0);
-    EXPECT_TRUE(dynamic_cast<LessThanOperator*>(ops[0].op.get()) != nullptr);
+    EXPECT_EQ(OpKind::LessThan, ops.kind[0]);
     
     UNPROTECT(1);
 }
@@ -151,11 +147,11 @@ TEST_F(ASTHandlerTest, GatherLogicalOperators) {
     INTEGER(srcref)[2] = 1;
     INTEGER(srcref)[3] = 10;
     
-    std::vector<OperatorPos> ops = handler.gatherOperators(and_expr, srcref, false);
+    SiteTable ops = handler.gatherOperators(and_expr, srcref, false);
     
     // Verify we found the && operator
     ASSERT_GT(ops.size(), 0);
-    EXPECT_TRUE(dynamic_cast<LogicalAndOperator*>(ops[0].op.get()) != nullptr);
+    EXPECT_EQ(OpKind::LogicalAnd, ops.kind[0]);
     
     UNPROTECT(1);
     
@@ -171,7 +167,7 @@ TEST_F(ASTHandlerTest, GatherLogicalOperators) {
     
     // Verify we found the || operator
     ASSERT_GT(ops.size(), 0);
-    EXPECT_TRUE(dynamic_cast<LogicalOrOperator*>(ops[0].op.get()) != nullptr);
+    EXPECT_EQ(OpKind::LogicalOr, ops.kind[0]);
     
     UNPROTECT(1);
 }
@@ -197,7 +193,7 @@ TEST_F(ASTHandlerTest, PathTracking) {
     INTEGER(srcref)[2] = 1;
     INTEGER(srcref)[3] = 15;
     
-    std::vector<OperatorPos> ops = handler.gatherOperators(plus_expr, srcref, false);
+    SiteTable ops = handler.gatherOperators(plus_expr, srcref, false);
     
     // We should have found 2 operators: + and *
     ASSERT_EQ(2, ops.size());
@@ -208,14 +204,14 @@ TEST_F(ASTHandlerTest, PathTracking) {
     bool found_plus = false;
     bool found_mul = false;
     
-    for (const auto& op : ops) {
-        if (dynamic_cast<PlusOperator*>(op.op.get())) {
+    for (int i = 0; i < ops.size(); i++) {
+        if (ops.kind[i] == OpKind::Plus) {
             found_plus = true;
-            EXPECT_EQ(0, op.path.size());
-        } else if (dynamic_cast<MultiplyOperator*>(op.op.get())) {
+            EXPECT_EQ(0, ops.path_length[i]);
+        } else if (ops.kind[i] == OpKind::Multiply) {
             found_mul = true;
-            ASSERT_EQ(1, op.path.size());
-            EXPECT_EQ(1, op.path[0]);
+            ASSERT_EQ(1, ops.path_length[i]);
+            EXPECT_EQ(1, ops.pathData(i)[0]);
         }
     }
     
@@ -225,6 +221,64 @@ TEST_F(ASTHandlerTest, PathTracking) {
     UNPROTECT(3);
 }
 
+// The scanner finds the sites the handler gathers over R's parse
+TEST_F(ASTHandlerTest, ScannerFindsSites) {
+    ScannedFile file = RScanner().scan("f <- function(x) x * 2\n{\n  a <- b |> g(y - 1)\n}\n");
+    ASSERT_TRUE(file.error.empty());
+    EXPECT_EQ(2, file.n_exprs);
+    ASSERT_EQ(5, static_cast<int>(file.sites.size()));
+
+    // `*` is the body of the function, the operator token gives its range
+    const ScannedSite &mul = file.sites[0];
+    EXPECT_EQ(OpKind::Multiply, mul.kind);
+    EXPECT_FALSE(mul.in_block);
+    ASSERT_EQ(2, mul.path_length);
+    EXPECT_EQ(1, file.pathData(0)[0]);
+    EXPECT_EQ(1, file.pathData(0)[1]);
+    EXPECT_EQ(2, mul.node_index);
+    EXPECT_EQ(1, mul.line1);
+    EXPECT_EQ(20, mul.col1);
+    EXPECT_EQ(19, mul.byte1);
+    EXPECT_EQ(20, mul.byte2);
+
+    // the assignment inside the block is a statement that can be deleted
+    EXPECT_EQ(OpKind::Delete, file.sites[1].kind);
+    EXPECT_TRUE(file.sites[1].in_block);
+    EXPECT_EQ(3, file.sites[1].col1);
+    EXPECT_EQ(20, file.sites[1].col2);
+
+    // the piped call takes `b` as its first argument
+    const ScannedSite &minus = file.sites[3];
+    EXPECT_EQ(OpKind::Minus, minus.kind);
+    ASSERT_EQ(3, minus.path_length);
+    EXPECT_EQ(0, file.pathData(3)[0]);
+    EXPECT_EQ(1, file.pathData(3)[1]);
+    EXPECT_EQ(1, file.pathData(3)[2]);
+}
+
+// Files scanned on several threads come back in order
+TEST_F(ASTHandlerTest, ScannerKeepsFileOrder) {
+    std::vector<std::string> paths;
+    for (int i = 0; i < 8; ++i) {
+        paths.push_back(testing::TempDir() + "scan" + std::to_string(i) + ".R");
+        FILE *out = fopen(paths.back().c_str(), "w");
+        ASSERT_NE(nullptr, out);
+        for (int j = 0; j <= i; ++j)
+            fputs("x <- a + b\n", out);
+        fclose(out);
+    }
+    paths.push_back(testing::TempDir() + "missing.R");
+
+    std::vector<ScannedFile> files = RScanner().scanFiles(paths, 3);
+    ASSERT_EQ(paths.size(), files.size());
+    for (int i = 0; i < 8; ++i) {
+        EXPECT_TRUE(files[i].error.empty());
+        EXPECT_EQ(i + 1, files[i].n_exprs);
+        EXPECT_EQ(i + 1, static_cast<int>(files[i].sites.size()));
+    }
+    EXPECT_FALSE(files[8].error.empty());
+}
+
 // Main function that runs all tests
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,319 @@
+#include <benchmark/benchmark.h>
+#include <R.h>
+#include <Rinternals.h>
+#include <Rembedded.h>
+#define R_INTERFACE_PTRS
+#include <Rinterface.h>
+#include "../src/AllocStats.hpp"
+#include "../src/ASTHandler.hpp"
+#include "../src/Mutator.hpp"
+#include "../src/ParseDataIndex.hpp"
+#include "../src/RScanner.hpp"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Throughput of the native generation path: site gathering, single
+// mutations, whole-file mutation and the standalone scanner, over synthetic
+// ASTs of a given depth, width and operator density and over real R files.
+//
+//   make bench                       # every benchmark
+//   ./GenerationBenchmark --benchmark_filter=MutateFile
+//
+// Besides time, each benchmark reports sites/s or mutants/s and, per
+// iteration, every C++ heap byte the process allocated, the buffers and R
+// objects the mutation layer allocated (as AllocStats counts them) and the
+// R garbage collections.
+
+extern "C" SEXP C_mutate_file(SEXP exprs, SEXP validate, SEXP budget, SEXP seed,
+                              SEXP strategy);
+extern std::vector<bool> detect_block_expressions(SEXP exprs, int n_expr);
+
+// ---------------------------------------------------------------------------
+// Allocation and GC counters
+
+static std::atomic<long long> g_heap_bytes(0);
+static long long g_gc_count = 0;
+
+// Only this benchmark binary replaces the global allocator; the package
+// counts its own buffers through AllocStats instead
+void *operator new(std::size_t size)
+{
+    g_heap_bytes.fetch_add(static_cast<long long>(size), std::memory_order_relaxed);
+    if (void *p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+
+// With gcinfo(TRUE) R reports every collection on the console; count those
+// reports instead of printing them and pass everything else through
+static void countingConsole(const char *buf, int len, int otype)
+{
+    if (otype != 0 && std::strncmp(buf, "Garbage collection ", 19) == 0)
+        ++g_gc_count;
+    else if (otype == 0 || !std::strstr(buf, "Mbytes of"))
+        std::fwrite(buf, 1, len, otype == 0 ? stdout : stderr);
+}
+
+// Allocations and collections since construction, reported per iteration
+class AllocationCounter {
+public:
+    AllocationCounter()
+        : _start(AllocStats::now()), _bytes(g_heap_bytes.load()), _gcs(g_gc_count) {}
+    ~AllocationCounter() = default;
+
+    void report(benchmark::State& state) const {
+        const AllocCounts d = AllocStats::now() - _start;
+        state.counters["heap_bytes"] = benchmark::Counter(
+            static_cast<double>(g_heap_bytes.load() - _bytes), benchmark::Counter::kAvgIterations);
+        state.counters["layer_heap_bytes"] = benchmark::Counter(
+            d.heap_bytes, benchmark::Counter::kAvgIterations);
+        state.counters["sexps"] = benchmark::Counter(d.sexps, benchmark::Counter::kAvgIterations);
+        state.counters["sexp_bytes"] = benchmark::Counter(d.sexp_bytes,
+                                                          benchmark::Counter::kAvgIterations);
+        state.counters["gcs"] = benchmark::Counter(
+            static_cast<double>(g_gc_count - _gcs), benchmark::Counter::kAvgIterations);
+    }
+
+private:
+    AllocCounts _start;
+    long long _bytes;
+    long long _gcs;
+};
+
+// ---------------------------------------------------------------------------
+// Inputs
+
+static const char *SYNTHETIC_OPS[] = {"+", "-", "*", "/", "<", ">=", "==", "&", "|"};
+
+// Random call tree `depth` levels deep: each call is one of the flippable
+// binary operators with probability density/100, otherwise a call to `f`
+// with `width` arguments; leaves are symbols and numeric constants
+static SEXP syntheticNode(std::mt19937& rng, int depth, int width, int density)
+{
+    if (depth == 0)
+        return rng() % 2 ? Rf_install("x") : Rf_ScalarReal(static_cast<double>(rng() % 10));
+
+    const bool is_op = static_cast<int>(rng() % 100) < density;
+    const int n_args = is_op ? 2 : width;
+    SEXP call = PROTECT(Rf_allocList(n_args + 1));
+    SET_TYPEOF(call, LANGSXP);
+    SETCAR(call, Rf_install(is_op ? SYNTHETIC_OPS[rng() % 9] : "f"));
+    for (SEXP arg = CDR(call); arg != R_NilValue; arg = CDR(arg))
+        SETCAR(arg, syntheticNode(rng, depth - 1, width, density));
+    UNPROTECT(1);
+    return call;
+}
+
+// A file of `n_expr` assignments of synthetic trees, with a srcref per
+// expression; kept alive until released by the caller
+static SEXP syntheticFile(int n_expr, int depth, int width, int density)
+{
+    std::mt19937 rng(42);
+    SEXP exprs = PROTECT(Rf_allocVector(EXPRSXP, n_expr));
+    SEXP src_refs = PROTECT(Rf_allocVector(VECSXP, n_expr));
+    for (int i = 0; i < n_expr; ++i) {
+        SEXP value = PROTECT(syntheticNode(rng, depth, width, density));
+        SET_VECTOR_ELT(exprs, i, Rf_lang3(Rf_install("<-"), Rf_install("y"), value));
+        SEXP srcref = Rf_allocVector(INTSXP, 4);
+        SET_VECTOR_ELT(src_refs, i, srcref);
+        INTEGER(srcref)[0] = INTEGER(srcref)[2] = i + 1;
+        INTEGER(srcref)[1] = 1;
+        INTEGER(srcref)[3] = 80;
+        UNPROTECT(1);
+    }
+    Rf_setAttrib(exprs, Rf_install("srcref"), src_refs);
+    R_PreserveObject(exprs);
+    UNPROTECT(2);
+    return exprs;
+}
+
+// parse(path, keep.source = TRUE), kept alive until released by the caller
+static SEXP parseFile(const std::string& path)
+{
+    SEXP call = PROTECT(Rf_lang3(Rf_install("parse"), Rf_mkString(path.c_str()), R_TrueValue));
+    SET_TAG(CDDR(call), Rf_install("keep.source"));
+    int failed = 0;
+    SEXP exprs = R_tryEval(call, R_GlobalEnv, &failed);
+    UNPROTECT(1);
+    if (failed)
+        return R_NilValue;
+    R_PreserveObject(exprs);
+    return exprs;
+}
+
+static std::vector<SiteTable> gatherFile(SEXP exprs)
+{
+    const int n_expr = Rf_length(exprs);
+    SEXP src_refs = Rf_getAttrib(exprs, Rf_install("srcref"));
+    const std::vector<bool> in_block = detect_block_expressions(exprs, n_expr);
+    const ParseDataIndex index(exprs);
+    std::vector<SiteTable> tables;
+    tables.reserve(n_expr);
+    for (int i = 0; i < n_expr; ++i) {
+        ASTHandler handler;
+        tables.push_back(handler.gatherOperators(VECTOR_ELT(exprs, i), VECTOR_ELT(src_refs, i),
+                                                 in_block[i], &index));
+    }
+    return tables;
+}
+
+static const int SYNTHETIC_EXPRS = 16;
+
+// depth x width x operator density (%)
+static void syntheticArgs(benchmark::internal::Benchmark *b)
+{
+    b->ArgNames({"depth", "width", "density"});
+    for (int depth : {4, 8})
+        for (int width : {2, 3})
+            for (int density : {20, 80})
+                b->Args({depth, width, density});
+}
+
+// ---------------------------------------------------------------------------
+// Benchmarks
+
+static void gatherOperators(benchmark::State& state, SEXP exprs)
+{
+    long long sites = 0;
+    const AllocationCounter counter;
+    for (auto _ : state) {
+        std::vector<SiteTable> tables = gatherFile(exprs);
+        for (const SiteTable& table : tables)
+            sites += table.size();
+        benchmark::DoNotOptimize(tables.data());
+    }
+    counter.report(state);
+    state.counters["sites"] = benchmark::Counter(static_cast<double>(sites),
+                                                 benchmark::Counter::kIsRate);
+}
+
+static void applyMutations(benchmark::State& state, SEXP exprs)
+{
+    const std::vector<SiteTable> tables = gatherFile(exprs);
+    Mutator mutator;
+    long long mutants = 0;
+    const AllocationCounter counter;
+    for (auto _ : state) {
+        for (int i = 0; i < static_cast<int>(tables.size()); ++i)
+            for (int j = 0; j < tables[i].size(); ++j) {
+                auto result = mutator.applyMutation(VECTOR_ELT(exprs, i), tables[i], j);
+                if (!result.second)
+                    continue;
+                ++mutants;
+                UNPROTECT(1);
+            }
+    }
+    counter.report(state);
+    state.counters["mutants"] = benchmark::Counter(static_cast<double>(mutants),
+                                                   benchmark::Counter::kIsRate);
+}
+
+static void mutateFile(benchmark::State& state, SEXP exprs)
+{
+    SEXP validate = PROTECT(Rf_mkString("syntax"));
+    long long mutants = 0;
+    const AllocationCounter counter;
+    for (auto _ : state) {
+        SEXP res = C_mutate_file(exprs, validate, R_NilValue, R_NilValue, R_NilValue);
+        mutants += Rf_length(res);
+    }
+    counter.report(state);
+    state.counters["mutants"] = benchmark::Counter(static_cast<double>(mutants),
+                                                   benchmark::Counter::kIsRate);
+    UNPROTECT(1);
+}
+
+static void scanText(benchmark::State& state, const std::string& text)
+{
+    const RScanner scanner;
+    long long sites = 0;
+    const AllocationCounter counter;
+    for (auto _ : state) {
+        ScannedFile file = scanner.scan(text);
+        sites += static_cast<long long>(file.sites.size());
+        benchmark::DoNotOptimize(file.sites.data());
+    }
+    counter.report(state);
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                            static_cast<int64_t>(text.size()));
+    state.counters["sites"] = benchmark::Counter(static_cast<double>(sites),
+                                                 benchmark::Counter::kIsRate);
+}
+
+template <void (*Run)(benchmark::State&, SEXP)>
+static void BM_Synthetic(benchmark::State& state)
+{
+    SEXP exprs = syntheticFile(SYNTHETIC_EXPRS, static_cast<int>(state.range(0)),
+                               static_cast<int>(state.range(1)), static_cast<int>(state.range(2)));
+    Run(state, exprs);
+    R_ReleaseObject(exprs);
+}
+
+BENCHMARK_TEMPLATE(BM_Synthetic, gatherOperators)->Name("GatherOperators")->Apply(syntheticArgs);
+BENCHMARK_TEMPLATE(BM_Synthetic, applyMutations)->Name("ApplyMutation")->Apply(syntheticArgs);
+BENCHMARK_TEMPLATE(BM_Synthetic, mutateFile)->Name("MutateFile")->Apply(syntheticArgs);
+
+// Real files: the samples and the package's own sources, or the R files
+// given after the benchmark flags
+static void registerFileBenchmarks(const std::vector<std::string>& paths)
+{
+    for (const std::string& path : paths) {
+        std::ifstream in(path, std::ios::binary);
+        if (!in) {
+            std::fprintf(stderr, "Skipping %s: cannot open file\n", path.c_str());
+            continue;
+        }
+        std::ostringstream text;
+        text << in.rdbuf();
+
+        SEXP exprs = parseFile(path);   // released at exit
+        if (exprs == R_NilValue) {
+            std::fprintf(stderr, "Skipping %s: cannot parse file\n", path.c_str());
+            continue;
+        }
+        const std::string name = path.substr(path.find_last_of('/') + 1);
+        benchmark::RegisterBenchmark(("GatherOperators/" + name).c_str(), gatherOperators, exprs);
+        benchmark::RegisterBenchmark(("ApplyMutation/" + name).c_str(), applyMutations, exprs);
+        benchmark::RegisterBenchmark(("MutateFile/" + name).c_str(), mutateFile, exprs);
+        benchmark::RegisterBenchmark(("ScanFile/" + name).c_str(), scanText, text.str());
+    }
+}
+
+int main(int argc, char **argv)
+{
+    char *r_argv[] = {const_cast<char *>("R"), const_cast<char *>("--silent"),
+                      const_cast<char *>("--vanilla"), const_cast<char *>("--no-save")};
+    Rf_initEmbeddedR(sizeof(r_argv) / sizeof(r_argv[0]), r_argv);
+
+    R_Outputfile = NULL;
+    R_Consolefile = NULL;
+    ptr_R_WriteConsole = NULL;
+    ptr_R_WriteConsoleEx = countingConsole;
+    SEXP gcinfo = PROTECT(Rf_lang2(Rf_install("gcinfo"), R_TrueValue));
+    R_tryEval(gcinfo, R_GlobalEnv, NULL);
+    UNPROTECT(1);
+    // count the mutation layer's R objects and C++ buffers
+    AllocStats::enable(true);
+
+    benchmark::Initialize(&argc, argv);
+    std::vector<std::string> paths(argv + 1, argv + argc);
+    if (paths.empty())
+        paths = {"../R/sample/sample.R", "../R/sample/test_sample.R", "../R/mutatoRpackage.R"};
+    registerFileBenchmarks(paths);
+
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    Rf_endEmbeddedR(0);
+    return 0;
+}
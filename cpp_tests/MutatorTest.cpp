@@ -2,9 +2,8 @@
 #include <R.h>
 #include <Rinternals.h>
 #include "../src/Mutator.hpp"
-#include "../src/PlusOperator.hpp"
-#include "../src/MinusOperator.hpp"
-#include "../src/DeleteOperator.hpp"
+#include "../src/ASTHandler.hpp"
+#include "../src/AllocStats.hpp"
 #include <memory>
 #include <vector>
 
@@ -25,12 +24,12 @@ protected:
         return expr;
     }
 
-    // Helper method to create a plus operator position
-    OperatorPos createPlusOperatorPos() {
+    // Helper method to create a site table with a plus operator at the root
+    SiteTable createPlusSiteTable() {
+        SiteTable sites;
         std::vector<int> path; // Empty path for root operator
-        auto op = std::make_unique<PlusOperator>();
-        SEXP plus_symbol = Rf_install("+");
-        return OperatorPos(path, std::move(op), 1, 1, 1, 5, plus_symbol);
+        sites.add(OpKind::Plus, path, Rf_install("+"), 1, 1, 1, 5);
+        return sites;
     }
 
     // Helper method to create a binary operation
@@ -67,9 +66,8 @@ TEST_F(MutatorTest, ApplyMutationFlip) {
     SEXP expr = createPlusExpression();
     PROTECT(expr);
     
-    // Create operator positions list with one PlusOperator
-    std::vector<OperatorPos> ops;
-    ops.push_back(createPlusOperatorPos());
+    // Create a site table with one plus operator
+    SiteTable ops = createPlusSiteTable();
     
     // Apply mutation at index 0
     auto result = mutator->applyMutation(expr, ops, 0);
@@ -95,12 +93,10 @@ TEST_F(MutatorTest, ApplyDeleteMutation) {
     SEXP expr = createBinaryOperation("+", "a", "b");
     PROTECT(expr);
     
-    // Create operator positions list with one DeleteOperator targeting the first argument
-    std::vector<OperatorPos> ops;
-    std::vector<int> path = {1}; // Target the first argument (index 1)
-    auto op = std::make_unique<DeleteOperator>(CDR(expr));
-    SEXP orig_symbol = CDR(expr);
-    ops.push_back(OperatorPos(path, std::move(op), 1, 1, 1, 5, orig_symbol));
+    // Create a site table with one deletion targeting the first argument
+    SiteTable ops;
+    std::vector<int> path = {0}; // Target the first argument (index 0)
+    ops.add(OpKind::Delete, path, CADR(expr), 1, 1, 1, 5);
     
     // Apply deletion mutation
     auto result = mutator->applyDeleteMutation(expr, ops, 0);
@@ -122,48 +118,70 @@ TEST_F(MutatorTest, ApplyDeleteMutation) {
     UNPROTECT(1);
 }
 
-// Test deleting the first element in the expression
-TEST_F(MutatorTest, ApplyDeleteFirstElement) {
-    // Create a simple expression
+// Test that the root of an expression cannot be deleted
+TEST_F(MutatorTest, ApplyDeleteRootRejected) {
     SEXP expr = createBinaryOperation("+", "a", "b");
     PROTECT(expr);
     
-    // Create operator positions list with one DeleteOperator targeting the operator itself (index 0)
-    std::vector<OperatorPos> ops;
-    std::vector<int> path = {0}; // Target the operator (index 0)
-    auto op = std::make_unique<DeleteOperator>(expr);
-    SEXP orig_symbol = CAR(expr);
-    ops.push_back(OperatorPos(path, std::move(op), 1, 1, 1, 5, orig_symbol));
+    // Create a site table with one deletion targeting the whole expression
+    SiteTable ops;
+    std::vector<int> path; // Empty path for the root
+    ops.add(OpKind::Delete, path, expr, 1, 1, 1, 5);
     
     // Apply deletion mutation
     auto result = mutator->applyDeleteMutation(expr, ops, 0);
     
-    // Check result
-    EXPECT_FALSE(result.second); // Special case handling
-    EXPECT_NE(result.first, expr); // Result is different from original
-    
-    // The new list should start with the former CDR of the original list
-    SEXP mutated = result.first;
-    EXPECT_STREQ(CHAR(PRINTNAME(CAR(mutated))), "a");
-    
-    // Check attributes for mutation info
-    SEXP mutation_info = Rf_getAttrib(mutated, Rf_install("mutation_info"));
-    EXPECT_FALSE(Rf_isNull(mutation_info));
+    // Nothing is deleted and the original is untouched
+    EXPECT_FALSE(result.second);
+    EXPECT_EQ(result.first, R_NilValue);
+    EXPECT_STREQ(CHAR(PRINTNAME(CAR(expr))), "+");
     
     UNPROTECT(1);
 }
 
+// Test that gathered sites delete their own node through the recorded spine
+TEST_F(MutatorTest, ApplyDeleteGatheredSite) {
+    // { a + b; c * d }
+    SEXP first = PROTECT(Rf_lang3(Rf_install("+"), Rf_install("a"), Rf_install("b")));
+    SEXP second = PROTECT(Rf_lang3(Rf_install("*"), Rf_install("c"), Rf_install("d")));
+    SEXP block = PROTECT(Rf_lang3(Rf_install("{"), first, second));
+    SEXP srcref = PROTECT(Rf_allocVector(INTSXP, 4));
+    for (int i = 0; i < 4; i++) INTEGER(srcref)[i] = 1;
+
+    ASTHandler handler;
+    SiteTable sites = handler.gatherOperators(block, srcref, true);
+
+    int which = -1;
+    for (int i = 0; i < sites.size(); i++) {
+        if (sites.kind[i] == OpKind::Delete && sites.path_length[i] == 1 &&
+            sites.pathData(i)[0] == 1)
+            which = i;
+    }
+    ASSERT_GE(which, 0);
+    EXPECT_EQ(sites.target(block, which), second);
+    EXPECT_EQ(sites.node_index[which], 2);
+
+    auto result = mutator->applyMutation(block, sites, which);
+    ASSERT_TRUE(result.second);
+
+    // c * d is gone, a + b is kept and shared with the original
+    SEXP mutated = result.first;
+    EXPECT_EQ(Rf_length(mutated), 2);
+    EXPECT_EQ(CADR(mutated), first);
+    EXPECT_EQ(Rf_length(block), 3);
+
+    UNPROTECT(5);
+}
+
 // Test with index out of bounds
 TEST_F(MutatorTest, ApplyDeleteOutOfBounds) {
     SEXP expr = createBinaryOperation("+", "a", "b");
     PROTECT(expr);
     
-    // Create operator positions list with one DeleteOperator with out-of-bounds path
-    std::vector<OperatorPos> ops;
+    // Create a site table with one deletion with out-of-bounds path
+    SiteTable ops;
     std::vector<int> path = {5}; // Index that doesn't exist
-    auto op = std::make_unique<DeleteOperator>(expr);
-    SEXP orig_symbol = CAR(expr);
-    ops.push_back(OperatorPos(path, std::move(op), 1, 1, 1, 5, orig_symbol));
+    ops.add(OpKind::Delete, path, CAR(expr), 1, 1, 1, 5);
     
     // Apply deletion mutation
     auto result = mutator->applyDeleteMutation(expr, ops, 0);
@@ -180,12 +198,10 @@ TEST_F(MutatorTest, ApplyMutationNestedExpression) {
     SEXP expr = createNestedExpression();
     PROTECT(expr);
     
-    // Create operator positions list with one operator targeting the nested multiplication
-    std::vector<OperatorPos> ops;
+    // Create a site table with one operator targeting the nested multiplication
+    SiteTable ops;
     std::vector<int> path = {1}; // Path to the multiply operator
-    auto op = std::make_unique<MinusOperator>();
-    SEXP mul_symbol = Rf_install("*");
-    ops.push_back(OperatorPos(path, std::move(op), 1, 5, 1, 10, mul_symbol));
+    ops.add(OpKind::Multiply, path, Rf_install("*"), 1, 5, 1, 10);
     
     // Apply mutation to the nested multiply
     auto result = mutator->applyFlipMutation(expr, ops, 0);
@@ -194,10 +210,10 @@ TEST_F(MutatorTest, ApplyMutationNestedExpression) {
     EXPECT_TRUE(result.second); // Mutation applied successfully
     EXPECT_NE(result.first, expr); // Result is different from original
     
-    // Check if the nested operation was mutated from * to -
+    // Check if the nested operation was mutated from * to /
     SEXP mutated = result.first;
     SEXP nested_op = CAR(CADDR(mutated));
-    EXPECT_STREQ(CHAR(PRINTNAME(nested_op)), "-");
+    EXPECT_STREQ(CHAR(PRINTNAME(nested_op)), "/");
     
     // The rest of the structure should remain the same
     EXPECT_STREQ(CHAR(PRINTNAME(CAR(mutated))), "+");
@@ -209,6 +225,75 @@ TEST_F(MutatorTest, ApplyMutationNestedExpression) {
     UNPROTECT(1);
 }
 
+// Test that a mutant shares untouched subtrees and leaves the original intact
+TEST_F(MutatorTest, FlipSharesUntouchedSubtrees) {
+    SEXP expr = createNestedExpression();
+    PROTECT(expr);
+
+    // Flip the root + and keep the nested multiplication untouched
+    SiteTable ops = createPlusSiteTable();
+
+    auto result = mutator->applyFlipMutation(expr, ops, 0);
+    EXPECT_TRUE(result.second);
+
+    SEXP mutated = result.first;
+    EXPECT_STREQ(CHAR(PRINTNAME(CAR(mutated))), "-");
+    EXPECT_STREQ(CHAR(PRINTNAME(CAR(expr))), "+");
+    EXPECT_EQ(CADDR(mutated), CADDR(expr)); // b * c is shared, not copied
+
+    UNPROTECT(2);
+}
+
+// Test that the duplicating mode never shares cells with the original
+TEST_F(MutatorTest, FlipWithoutSharingDuplicates) {
+    SEXP expr = createNestedExpression();
+    PROTECT(expr);
+
+    SiteTable ops = createPlusSiteTable();
+
+    Mutator duplicating(false);
+    auto result = duplicating.applyFlipMutation(expr, ops, 0);
+    EXPECT_TRUE(result.second);
+    EXPECT_NE(CADDR(result.first), CADDR(expr));
+    EXPECT_STREQ(CHAR(PRINTNAME(CAR(expr))), "+");
+
+    UNPROTECT(2);
+}
+
+// Test that the allocation counters see how much less a shared flip builds
+TEST_F(MutatorTest, AllocStatsCountMutantObjects) {
+    SEXP expr = createNestedExpression();
+    PROTECT(expr);
+    SiteTable ops = createPlusSiteTable();
+
+    AllocStats::reset();
+    AllocStats::enable(true);
+    AllocCounts start = AllocStats::now();
+    mutator->applyFlipMutation(expr, ops, 0);
+    const AllocCounts shared = AllocStats::now() - start;
+
+    start = AllocStats::now();
+    Mutator(false).applyFlipMutation(expr, ops, 0);
+    const AllocCounts duplicated = AllocStats::now() - start;
+
+    start = AllocStats::now();
+    std::vector<int> ints(100);
+    AllocStats::buffer(ints);
+    std::vector<int> unused(100);
+    const AllocCounts heap = AllocStats::now() - start;
+    AllocStats::enable(false);
+    AllocStats::reset();
+
+    EXPECT_GT(shared.sexps, 0);
+    EXPECT_GT(shared.heap_allocs, 0);
+    EXPECT_GT(duplicated.sexps, shared.sexps);
+    EXPECT_GT(duplicated.sexp_bytes, shared.sexp_bytes);
+    EXPECT_EQ(heap.heap_allocs, 1);
+    EXPECT_GE(heap.heap_bytes, 100 * sizeof(int));
+
+    UNPROTECT(3);
+}
+
 // Test with different operator types
 TEST_F(MutatorTest, DifferentOperatorTypes) {
     // Test with different binary operations
@@ -218,12 +303,10 @@ TEST_F(MutatorTest, DifferentOperatorTypes) {
         SEXP expr = createBinaryOperation(op, "a", "b");
         PROTECT(expr);
         
-        // Create operator positions list with a DeleteOperator for this expression
-        std::vector<OperatorPos> ops;
-        std::vector<int> path = {1}; // Target first argument
-        auto del_op = std::make_unique<DeleteOperator>(CDR(expr));
-        SEXP orig_symbol = CAR(expr);
-        ops.push_back(OperatorPos(path, std::move(del_op), 1, 1, 1, 5, orig_symbol));
+        // Create a site table with a deletion for this expression
+        SiteTable ops;
+        std::vector<int> path = {0}; // Target first argument
+        ops.add(OpKind::Delete, path, CAR(expr), 1, 1, 1, 5);
         
         // Apply deletion
         auto result = mutator->applyDeleteMutation(expr, ops, 0);
@@ -236,6 +319,40 @@ TEST_F(MutatorTest, DifferentOperatorTypes) {
     }
 }
 
+// Test a higher-order mutant of several sites of one expression
+TEST_F(MutatorTest, ApplyMutationsCombinesSites) {
+    // { a + b; c * d }
+    SEXP plus = PROTECT(Rf_lang3(Rf_install("+"), Rf_install("a"), Rf_install("b")));
+    SEXP times = PROTECT(Rf_lang3(Rf_install("*"), Rf_install("c"), Rf_install("d")));
+    SEXP expr = PROTECT(Rf_lang3(Rf_install("{"), plus, times));
+    SEXP srcref = PROTECT(Rf_allocVector(INTSXP, 4));
+    for (int k = 0; k < 4; ++k) INTEGER(srcref)[k] = 1;
+
+    ASTHandler handler;
+    SiteTable ops = handler.gatherOperators(expr, srcref, true);
+    std::vector<int> which;
+    for (int k = 0; k < ops.size(); ++k) {
+        const bool first_statement = ops.path_length[k] == 1 && ops.pathData(k)[0] == 0;
+        if (ops.kind[k] == OpKind::Plus || ops.kind[k] == OpKind::Multiply ||
+            (ops.kind[k] == OpKind::Delete && first_statement))
+            which.push_back(k);
+    }
+    ASSERT_EQ(which.size(), 3u);
+
+    // the flip inside the deleted statement goes with it: { c / d }
+    auto result = mutator->applyMutations(expr, ops, which);
+    ASSERT_TRUE(result.second);
+    EXPECT_EQ(Rf_length(result.first), 2);
+    EXPECT_EQ(CAR(CADR(result.first)), Rf_install("/"));
+
+    // the original is left as is
+    EXPECT_EQ(Rf_length(expr), 3);
+    EXPECT_EQ(CAR(plus), Rf_install("+"));
+    EXPECT_EQ(CAR(times), Rf_install("*"));
+
+    UNPROTECT(5);
+}
+
 // Main function that runs all tests
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
@@ -2,13 +2,20 @@
 #include <R.h>
 #include <Rinternals.h>
 #include <R_ext/Parse.h>
+#include "../src/MutantValidator.hpp"
 #include <memory>
 #include <vector>
 
 // Forward declarations of C functions to test
 extern "C" SEXP C_mutate_single(SEXP expr_sexp, SEXP src_ref_sexp, bool is_inside_block);
-extern "C" SEXP C_mutate_file(SEXP exprs);
-extern bool isValidMutant(SEXP mutant);
+extern "C" SEXP C_mutate_file(SEXP exprs, SEXP validate, SEXP budget, SEXP seed,
+                              SEXP strategy);
+extern "C" SEXP C_mutate_schemata(SEXP exprs, SEXP first_id);
+extern "C" SEXP C_mutant_stream(SEXP exprs, SEXP validate, SEXP budget, SEXP seed,
+                                SEXP strategy, SEXP site_ids);
+extern "C" SEXP C_stream_next(SEXP stream);
+extern "C" SEXP C_stream_next_batch(SEXP stream, SEXP n);
+extern bool isValidMutant(SEXP exprs, int expr_index, SEXP replacement, ValidationMode mode);
 extern std::vector<bool> detect_block_expressions(SEXP exprs, int n_expr);
 
 class MutateRTest : public ::testing::Test {
@@ -234,9 +241,12 @@ TEST_F(MutateRTest, ValidMutant) {
     // Create a valid expression
     SEXP validExpr = createExpression("+", "a", "b");
     PROTECT(validExpr);
+    SEXP exprList = PROTECT(Rf_allocVector(EXPRSXP, 1));
+    SET_VECTOR_ELT(exprList, 0, validExpr);
     
-    // Check if it's considered valid
-    bool isValid = isValidMutant(validExpr);
+    // Check if it's considered valid with the expression as its own replacement
+    bool isValid = isValidMutant(exprList, 0, validExpr, ValidationMode::Eval);
+    (void) isValid;
     
     // This test is tricky because isValidMutant evaluates the expression in R,
     // which may not be possible in a unit test without a fully initialized R environment.
@@ -244,7 +254,25 @@ TEST_F(MutateRTest, ValidMutant) {
     // In a real test environment, we'd need to set up variables 'a' and 'b'
     // in R_GlobalEnv first.
     
-    UNPROTECT(1);
+    UNPROTECT(2);
+}
+
+// Test the syntactic check rejects a malformed mutant without evaluating it
+TEST_F(MutateRTest, SyntaxValidationRejectsMalformedMutant) {
+    SEXP original = createExpression("*", "a", "b");
+    PROTECT(original);
+    SEXP exprList = PROTECT(Rf_allocVector(EXPRSXP, 1));
+    SET_VECTOR_ELT(exprList, 0, original);
+
+    // `*`("b") is what deleting the first operand produces
+    SEXP broken = PROTECT(Rf_lang2(Rf_install("*"), Rf_mkString("b")));
+    EXPECT_FALSE(isValidMutant(exprList, 0, broken, ValidationMode::Syntax));
+    EXPECT_TRUE(isValidMutant(exprList, 0, broken, ValidationMode::None));
+
+    SEXP flipped = PROTECT(createExpression("/", "a", "b"));
+    EXPECT_TRUE(isValidMutant(exprList, 0, flipped, ValidationMode::Syntax));
+
+    UNPROTECT(4);
 }
 
 // Test C_mutate_file
@@ -272,11 +300,19 @@ TEST_F(MutateRTest, MutateFile) {
     SET_TYPEOF(exprList, EXPRSXP);
     
     // Call C_mutate_file
-    SEXP result = C_mutate_file(exprList);
+    SEXP result = C_mutate_file(exprList, R_NilValue, R_NilValue, R_NilValue, R_NilValue);
     PROTECT(result);
     
-    // Verify result is a list
+    // Verify result is a list of deltas against the original file
     EXPECT_EQ(TYPEOF(result), VECSXP);
+    for (int i = 0; i < Rf_length(result); i++) {
+        SEXP delta = VECTOR_ELT(result, i);
+        EXPECT_EQ(TYPEOF(delta), VECSXP);
+        EXPECT_EQ(Rf_length(delta), 2);
+        int exprIndex = INTEGER(VECTOR_ELT(delta, 0))[0];
+        EXPECT_TRUE(exprIndex == 1 || exprIndex == 2);
+        EXPECT_NE(VECTOR_ELT(delta, 1), VECTOR_ELT(exprList, exprIndex - 1));
+    }
     
     // This test is also tricky due to the call to isValidMutant
     // which requires a properly initialized R environment.
@@ -285,6 +321,125 @@ TEST_F(MutateRTest, MutateFile) {
     UNPROTECT(4);
 }
 
+// Test C_mutate_schemata
+TEST_F(MutateRTest, MutateSchemataSwitchesEachSite) {
+    SEXP plus = PROTECT(Rf_lang3(Rf_install("+"), Rf_install("a"), Rf_install("b")));
+    SEXP exprList = PROTECT(createExpressionList({plus}));
+    attachSrcRefs(exprList, {createSrcRef(1, 1, 1, 5)});
+    SET_TYPEOF(exprList, EXPRSXP);
+
+    SEXP result = PROTECT(C_mutate_schemata(exprList, Rf_ScalarInteger(10)));
+    SEXP ids = VECTOR_ELT(result, 1);
+    ASSERT_EQ(Rf_length(ids), 1);
+    EXPECT_EQ(INTEGER(ids)[0], 10);
+
+    // if (.mutant_id == 10L) a - b else a + b
+    SEXP schema = VECTOR_ELT(VECTOR_ELT(result, 0), 0);
+    ASSERT_EQ(TYPEOF(schema), LANGSXP);
+    EXPECT_EQ(CAR(schema), Rf_install("if"));
+    SEXP cond = CADR(schema);
+    EXPECT_EQ(CADR(cond), Rf_install(".mutant_id"));
+    EXPECT_EQ(INTEGER(CADDR(cond))[0], 10);
+    EXPECT_EQ(CAR(CADDR(schema)), Rf_install("-"));
+    EXPECT_EQ(CAR(CADDDR(schema)), Rf_install("+"));
+
+    // the parsed expression is left as is
+    EXPECT_EQ(CAR(plus), Rf_install("+"));
+
+    UNPROTECT(3);
+}
+
+// Test that C_mutate_file leaves out sites the static rules prove equivalent
+TEST_F(MutateRTest, MutateFileSkipsEquivalentSites) {
+    // a * 1 and b < b only have equivalent flips, a - c has one real mutant
+    SEXP times_one = PROTECT(Rf_lang3(Rf_install("*"), Rf_install("a"), Rf_ScalarReal(1)));
+    SEXP less_self = PROTECT(Rf_lang3(Rf_install("<"), Rf_install("b"), Rf_install("b")));
+    SEXP minus = PROTECT(Rf_lang3(Rf_install("-"), Rf_install("a"), Rf_install("c")));
+    SEXP exprList = PROTECT(createExpressionList({times_one, less_self, minus}));
+    attachSrcRefs(exprList, {createSrcRef(1, 1, 1, 5), createSrcRef(2, 1, 2, 5),
+                             createSrcRef(3, 1, 3, 5)});
+    SET_TYPEOF(exprList, EXPRSXP);
+
+    SEXP result = PROTECT(C_mutate_file(exprList, R_NilValue, R_NilValue, R_NilValue, R_NilValue));
+    ASSERT_EQ(Rf_length(result), 1);
+    EXPECT_EQ(INTEGER(VECTOR_ELT(VECTOR_ELT(result, 0), 0))[0], 3);
+
+    UNPROTECT(5);
+}
+
+// Test that a budget builds only the drawn mutants, reproducibly per seed
+TEST_F(MutateRTest, MutateFileBudget) {
+    std::vector<SEXP> exprs;
+    std::vector<SEXP> srcRefs;
+    const char *ops[] = {"+", "-", "*", "/"};
+    for (int i = 0; i < 4; ++i) {
+        exprs.push_back(PROTECT(Rf_lang3(Rf_install(ops[i]), Rf_install("a"), Rf_install("b"))));
+        srcRefs.push_back(createSrcRef(i + 1, 1, i + 1, 5));
+    }
+    SEXP exprList = PROTECT(createExpressionList(exprs));
+    attachSrcRefs(exprList, srcRefs);
+    SET_TYPEOF(exprList, EXPRSXP);
+
+    SEXP budget = PROTECT(Rf_ScalarInteger(2));
+    SEXP seed = PROTECT(Rf_ScalarInteger(42));
+    SEXP first = PROTECT(C_mutate_file(exprList, R_NilValue, budget, seed, R_NilValue));
+    SEXP again = PROTECT(C_mutate_file(exprList, R_NilValue, budget, seed, R_NilValue));
+    ASSERT_EQ(Rf_length(first), 2);
+    ASSERT_EQ(Rf_length(again), 2);
+    for (int i = 0; i < 2; ++i)
+        EXPECT_EQ(INTEGER(VECTOR_ELT(VECTOR_ELT(first, i), 0))[0],
+                  INTEGER(VECTOR_ELT(VECTOR_ELT(again, i), 0))[0]);
+
+    // one mutant per top-level expression when stratified by function
+    SEXP four = PROTECT(Rf_ScalarInteger(4));
+    SEXP strategy = PROTECT(Rf_mkString("function"));
+    SEXP per_function = PROTECT(C_mutate_file(exprList, R_NilValue, four, seed, strategy));
+    EXPECT_EQ(Rf_length(per_function), 4);
+
+    UNPROTECT(12);
+}
+
+// Test that a stream yields the mutants of C_mutate_file in batches
+TEST_F(MutateRTest, MutantStreamYieldsBatches) {
+    std::vector<SEXP> exprs;
+    std::vector<SEXP> srcRefs;
+    const char *ops[] = {"+", "-", "*"};
+    for (int i = 0; i < 3; ++i) {
+        exprs.push_back(PROTECT(Rf_lang3(Rf_install(ops[i]), Rf_install("a"), Rf_install("b"))));
+        srcRefs.push_back(createSrcRef(i + 1, 1, i + 1, 5));
+    }
+    SEXP exprList = PROTECT(createExpressionList(exprs));
+    attachSrcRefs(exprList, srcRefs);
+    SET_TYPEOF(exprList, EXPRSXP);
+
+    SEXP all = PROTECT(C_mutate_file(exprList, R_NilValue, R_NilValue, R_NilValue, R_NilValue));
+    SEXP stream = PROTECT(C_mutant_stream(exprList, R_NilValue, R_NilValue, R_NilValue,
+                                          R_NilValue, R_NilValue));
+    SEXP two = PROTECT(Rf_ScalarInteger(2));
+    SEXP first = PROTECT(C_stream_next_batch(stream, two));
+    SEXP last = PROTECT(C_stream_next(stream));
+    ASSERT_EQ(Rf_length(all), 3);
+    ASSERT_EQ(Rf_length(first), 2);
+    ASSERT_NE(last, R_NilValue);
+    for (int i = 0; i < 2; ++i)
+        EXPECT_EQ(INTEGER(VECTOR_ELT(VECTOR_ELT(first, i), 0))[0],
+                  INTEGER(VECTOR_ELT(VECTOR_ELT(all, i), 0))[0]);
+    EXPECT_EQ(INTEGER(VECTOR_ELT(last, 0))[0], INTEGER(VECTOR_ELT(VECTOR_ELT(all, 2), 0))[0]);
+    EXPECT_EQ(INTEGER(Rf_getAttrib(last, Rf_install("site_id")))[0], 3);
+
+    // exhausted
+    EXPECT_EQ(C_stream_next(stream), R_NilValue);
+    EXPECT_EQ(Rf_length(C_stream_next_batch(stream, two)), 0);
+
+    // a batch far larger than the stream holds what is left, nothing more
+    SEXP fresh = PROTECT(C_mutant_stream(exprList, R_NilValue, R_NilValue, R_NilValue,
+                                         R_NilValue, R_NilValue));
+    SEXP many = PROTECT(Rf_ScalarInteger(1000000));
+    EXPECT_EQ(Rf_length(C_stream_next_batch(fresh, many)), 3);
+
+    UNPROTECT(11);
+}
+
 // Main function that runs all tests
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
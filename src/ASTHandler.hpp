@@ -2,11 +2,11 @@
 #ifndef AST_HANDLER_H
 #define AST_HANDLER_H
 
-#include "OperatorPos.hpp"
+#include "SiteTable.hpp"
+#include "ParseDataIndex.hpp"
 #include <R.h>
 #include <Rinternals.h>
 #include <vector>
-#include <memory>
 
 // Class to Handle AST Traversal and Operator Gathering
 class ASTHandler {
@@ -14,8 +14,10 @@ public:
     ASTHandler() = default;
     ~ASTHandler() = default;
 
-    // Gather all operators in the AST
-    std::vector<OperatorPos> gatherOperators(SEXP expr, SEXP src_ref, bool is_inside_block);
+    // Gather all operators in the AST; with a parse data index the sites
+    // carry the exact token ranges instead of the expression's srcref
+    SiteTable gatherOperators(SEXP expr, SEXP src_ref, bool is_inside_block,
+                              const ParseDataIndex *index = nullptr);
 
 private:
     int _start_line;
@@ -23,8 +25,20 @@ private:
     int _end_line;
     int _end_col;
     bool _is_inside_block;
-    // Recursive helper function
-    void gatherOperatorsRecursive(SEXP expr, std::vector<int> path, std::vector<OperatorPos>& ops);
+    // Argument indices and argument cells from the root to the current node
+    std::vector<int> _path;
+    std::vector<SEXP> _cells;
+    // Parse nodes of the arguments of every call on that path, one run per
+    // call; only used with a parse data index
+    std::vector<int> _arg_nodes;
+    // Pre-order index of the next LANGSXP node
+    int _node_index;
+    const ParseDataIndex *_index;
+    // Recursive helper function; the path stacks are restored on return.
+    // `token_node` is the parse data row of expr, -1 if unknown
+    void gatherOperatorsRecursive(SEXP expr, int token_node, SiteTable& sites);
+
+    SourceSpan spanOf(int token_node) const;
 
     bool isDeletable(SEXP expr);
 };
@@ -0,0 +1,256 @@
+// AllocStats.cpp
+
+#include <algorithm>
+#include "AllocStats.hpp"
+
+std::atomic<bool> AllocStats::_enabled(false);
+std::atomic<long long> AllocStats::_heap_allocs(0);
+std::atomic<long long> AllocStats::_heap_bytes(0);
+double AllocStats::_sexps = 0;
+double AllocStats::_sexp_bytes = 0;
+double AllocStats::_gcs = 0;
+SEXP AllocStats::_sentinel = nullptr;
+bool AllocStats::_sentinel_fired = false;
+std::map<std::string, AllocStats::EntryCounts> AllocStats::_entries;
+double AllocStats::_n_mutants = 0;
+AllocCounts AllocStats::_mutant_total;
+AllocCounts AllocStats::_mutant_max;
+
+AllocCounts AllocCounts::operator-(const AllocCounts& other) const
+{
+    AllocCounts d;
+    d.sexps       = sexps - other.sexps;
+    d.sexp_bytes  = sexp_bytes - other.sexp_bytes;
+    d.heap_allocs = heap_allocs - other.heap_allocs;
+    d.heap_bytes  = heap_bytes - other.heap_bytes;
+    d.gcs         = gcs - other.gcs;
+    return d;
+}
+
+AllocCounts& AllocCounts::operator+=(const AllocCounts& other)
+{
+    sexps       += other.sexps;
+    sexp_bytes  += other.sexp_bytes;
+    heap_allocs += other.heap_allocs;
+    heap_bytes  += other.heap_bytes;
+    gcs         += other.gcs;
+    return *this;
+}
+
+// Size of an object as R lays it out on a 64-bit build: a node is a 56 byte
+// cons cell, a vector a header followed by its elements
+static const double NODE_BYTES = 56;
+static const double VECTOR_HEADER_BYTES = 48;
+
+static double objectBytes(SEXP x)
+{
+    switch (TYPEOF(x)) {
+    case LGLSXP:
+    case INTSXP:
+        return VECTOR_HEADER_BYTES + XLENGTH(x) * sizeof(int);
+    case REALSXP:
+        return VECTOR_HEADER_BYTES + XLENGTH(x) * sizeof(double);
+    case CPLXSXP:
+        return VECTOR_HEADER_BYTES + XLENGTH(x) * sizeof(Rcomplex);
+    case RAWSXP:
+        return VECTOR_HEADER_BYTES + XLENGTH(x);
+    case STRSXP:
+    case VECSXP:
+    case EXPRSXP:
+        return VECTOR_HEADER_BYTES + XLENGTH(x) * sizeof(SEXP);
+    default:
+        return NODE_BYTES;
+    }
+}
+
+// Objects Rf_duplicate copies: cells, vectors and their attributes; symbols,
+// environments and strings' CHARSXPs are shared
+static void countTree(SEXP x, double *n, double *bytes)
+{
+    switch (TYPEOF(x)) {
+    case LISTSXP:
+    case LANGSXP:
+        for (; TYPEOF(x) == LISTSXP || TYPEOF(x) == LANGSXP; x = CDR(x)) {
+            *n += 1;
+            *bytes += NODE_BYTES;
+            countTree(CAR(x), n, bytes);
+            countTree(ATTRIB(x), n, bytes);
+        }
+        return;
+    case VECSXP:
+    case EXPRSXP:
+        for (R_xlen_t i = 0; i < XLENGTH(x); ++i)
+            countTree(VECTOR_ELT(x, i), n, bytes);
+        // fall through
+    case LGLSXP:
+    case INTSXP:
+    case REALSXP:
+    case CPLXSXP:
+    case STRSXP:
+    case RAWSXP:
+        *n += 1;
+        *bytes += objectBytes(x);
+        countTree(ATTRIB(x), n, bytes);
+        return;
+    default:
+        return;
+    }
+}
+
+void AllocStats::countSexp(SEXP x, bool deep)
+{
+    if (deep) {
+        countTree(x, &_sexps, &_sexp_bytes);
+        return;
+    }
+    _sexps += 1;
+    _sexp_bytes += objectBytes(x);
+}
+
+void AllocStats::countNodes(SEXP call)
+{
+    for (; call != R_NilValue; call = CDR(call)) {
+        _sexps += 1;
+        _sexp_bytes += NODE_BYTES;
+    }
+}
+
+void AllocStats::enable(bool on)
+{
+    if (!on)
+        disarm();
+    _enabled.store(on, std::memory_order_relaxed);
+}
+
+void AllocStats::reset()
+{
+    _heap_allocs.store(0, std::memory_order_relaxed);
+    _heap_bytes.store(0, std::memory_order_relaxed);
+    _sexps = _sexp_bytes = _gcs = 0;
+    _entries.clear();
+    _n_mutants = 0;
+    _mutant_total = AllocCounts();
+    _mutant_max = AllocCounts();
+}
+
+static void ignoreSentinel(SEXP) {}
+
+void AllocStats::arm()
+{
+    // a collection between calls belongs to none of them
+    poll();
+    if (_sentinel && !_sentinel_fired)
+        return;
+    disarm();
+    SEXP key = PROTECT(Rf_cons(R_NilValue, R_NilValue));
+    _sentinel = R_MakeWeakRefC(key, R_NilValue, ignoreSentinel, FALSE);
+    R_PreserveObject(_sentinel);
+    UNPROTECT(1);
+    _sentinel_fired = false;
+}
+
+void AllocStats::disarm()
+{
+    if (_sentinel)
+        R_ReleaseObject(_sentinel);
+    _sentinel = nullptr;
+}
+
+void AllocStats::poll()
+{
+    if (!_sentinel || _sentinel_fired)
+        return;
+    // a collection that finds the key unreachable queues the weak reference
+    // for finalization; running the finalizer clears the key
+    R_RunPendingFinalizers();
+    if (R_WeakRefKey(_sentinel) == R_NilValue) {
+        _gcs += 1;
+        _sentinel_fired = true;
+    }
+}
+
+AllocCounts AllocStats::start()
+{
+    arm();
+    return now();
+}
+
+AllocCounts AllocStats::finish(SEXP keep)
+{
+    PROTECT(keep);
+    poll();
+    UNPROTECT(1);
+    return now();
+}
+
+AllocCounts AllocStats::now()
+{
+    AllocCounts c;
+    c.sexps       = _sexps;
+    c.sexp_bytes  = _sexp_bytes;
+    c.heap_allocs = static_cast<double>(_heap_allocs.load(std::memory_order_relaxed));
+    c.heap_bytes  = static_cast<double>(_heap_bytes.load(std::memory_order_relaxed));
+    c.gcs         = _gcs;
+    return c;
+}
+
+void AllocStats::recordEntry(const char *entry, const AllocCounts& delta)
+{
+    EntryCounts &e = _entries[entry];
+    e.calls += 1;
+    e.counts += delta;
+}
+
+void AllocStats::recordMutant(const AllocCounts& delta)
+{
+    _n_mutants += 1;
+    _mutant_total += delta;
+    _mutant_max.sexps       = std::max(_mutant_max.sexps, delta.sexps);
+    _mutant_max.sexp_bytes  = std::max(_mutant_max.sexp_bytes, delta.sexp_bytes);
+    _mutant_max.heap_allocs = std::max(_mutant_max.heap_allocs, delta.heap_allocs);
+    _mutant_max.heap_bytes  = std::max(_mutant_max.heap_bytes, delta.heap_bytes);
+    _mutant_total.gcs = _mutant_max.gcs = 0;   // not attributed to mutants
+}
+
+static void fillCounts(double *out, const AllocCounts& c, R_xlen_t stride = 1)
+{
+    out[0]          = c.sexps;
+    out[stride]     = c.sexp_bytes;
+    out[2 * stride] = c.heap_allocs;
+    out[3 * stride] = c.heap_bytes;
+    out[4 * stride] = c.gcs;
+}
+
+SEXP AllocStats::toR()
+{
+    static const char *names[] = {"enabled", "entry", "calls", "entry_counts",
+                                  "mutants", "mutant_total", "mutant_max", ""};
+    SEXP res = PROTECT(Rf_mkNamed(VECSXP, names));
+    SET_VECTOR_ELT(res, 0, Rf_ScalarLogical(enabled()));
+
+    const int n = static_cast<int>(_entries.size());
+    SEXP entry  = Rf_allocVector(STRSXP, n);
+    SET_VECTOR_ELT(res, 1, entry);
+    SEXP calls  = Rf_allocVector(REALSXP, n);
+    SET_VECTOR_ELT(res, 2, calls);
+    SEXP counts = Rf_allocMatrix(REALSXP, n, 5);   // one column per field
+    SET_VECTOR_ELT(res, 3, counts);
+    int i = 0;
+    for (const auto& e : _entries) {
+        SET_STRING_ELT(entry, i, Rf_mkChar(e.first.c_str()));
+        REAL(calls)[i] = e.second.calls;
+        fillCounts(REAL(counts) + i, e.second.counts, n);
+        ++i;
+    }
+
+    SET_VECTOR_ELT(res, 4, Rf_ScalarReal(_n_mutants));
+    SEXP total = Rf_allocVector(REALSXP, 5);
+    SET_VECTOR_ELT(res, 5, total);
+    fillCounts(REAL(total), _mutant_total);
+    SEXP max = Rf_allocVector(REALSXP, 5);
+    SET_VECTOR_ELT(res, 6, max);
+    fillCounts(REAL(max), _mutant_max);
+
+    UNPROTECT(1);
+    return res;
+}
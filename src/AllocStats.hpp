@@ -0,0 +1,166 @@
+// AllocStats.h
+#ifndef ALLOC_STATS_H
+#define ALLOC_STATS_H
+
+#include <R.h>
+#include <Rinternals.h>
+
+// Undefine the 'length' macro defined by Rinternals.h to avoid conflicts with the C++ standard library
+#undef length
+
+#include <atomic>
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+// Allocations counted over some span of the mutation layer
+struct AllocCounts {
+    double sexps = 0;         // R objects the layer allocated
+    double sexp_bytes = 0;    // their estimated size
+    double heap_allocs = 0;   // C++ buffers the layer allocated
+    double heap_bytes = 0;    // their size
+    double gcs = 0;           // entry point calls during which R collected
+
+    AllocCounts operator-(const AllocCounts& other) const;
+    AllocCounts& operator+=(const AllocCounts& other);
+};
+
+// Opt-in instrumentation of the memory the mutation layer uses. While it is
+// enabled, the R objects the layer builds for mutants, deltas and results
+// are counted at the point of allocation, with sizes estimated from their
+// type and length. So are the C++ buffers the layer fills (site tables,
+// paths, parse data indexes, hash tables, messages), counted where it fills
+// them from their final capacity; reallocations while a buffer grows are
+// not seen, and nothing outside the layer is.
+//
+// Garbage collections are noticed through a weakly referenced sentinel
+// whose key is cleared when R finalizes it after a collection. Finalizers
+// run only when an entry point call starts and returns, so a call during
+// which R collected at least once counts one, however many collections it
+// saw; single mutants are not attributed any.
+//
+// Counts are attributed to entry points by AllocScope and to single mutants
+// by recordMutant. While disabled every hook is a single test of a flag.
+class AllocStats {
+public:
+    static bool enabled() { return _enabled.load(std::memory_order_relaxed); }
+    static void enable(bool on);
+    static void reset();
+
+    // Count an R object the layer just allocated and return it
+    static SEXP sexp(SEXP x) { if (enabled()) countSexp(x, false); return x; }
+    // Count every node of a freshly duplicated tree and return it
+    static SEXP tree(SEXP x) { if (enabled()) countSexp(x, true); return x; }
+    // Count the cells of a freshly built call, not its arguments
+    static SEXP nodes(SEXP call) { if (enabled()) countNodes(call); return call; }
+    // Count a C++ buffer of `bytes` the layer allocated; safe on any thread
+    static void heap(std::size_t bytes) {
+        if (!enabled()) return;
+        _heap_allocs.fetch_add(1, std::memory_order_relaxed);
+        _heap_bytes.fetch_add(static_cast<long long>(bytes), std::memory_order_relaxed);
+    }
+    // Count the buffer of a vector the layer filled, or, for one it reuses,
+    // the new buffer if it grew past the `capacity` it had before
+    template <class T>
+    static void buffer(const std::vector<T>& v, std::size_t capacity = 0) {
+        if (enabled() && v.capacity() > capacity)
+            heap(v.capacity() * sizeof(T));
+    }
+    // Count the buffer of a string the layer built, unless it fits in the
+    // string object itself
+    static void text(const std::string& s) {
+        if (enabled() && s.capacity() >= sizeof(std::string))
+            heap(s.capacity() + 1);
+    }
+    // Count a message built in a string stream: the stream's buffer and the
+    // string taken from it
+    static void message(const std::string& s) { text(s); text(s); }
+    // Count a node of a hashed or ordered container holding a `T`
+    template <class T>
+    static void node() { heap(sizeof(T) + 2 * sizeof(void *)); }
+
+    // Start an entry point call: make sure the next collection is noticed.
+    // Runs pending finalizers and allocates, so every object the caller
+    // holds has to be protected.
+    static AllocCounts start();
+    // End an entry point call: run R's pending finalizers so that a
+    // collection since start() shows, and return the counts. `keep` is
+    // protected meanwhile; every other object the caller holds has to be
+    // protected too.
+    static AllocCounts finish(SEXP keep);
+    // Counts since counting was enabled, without looking for collections;
+    // never allocates
+    static AllocCounts now();
+
+    static void recordEntry(const char *entry, const AllocCounts& delta);
+    static void recordMutant(const AllocCounts& delta);
+
+    // All counters for C_alloc_counters
+    static SEXP toR();
+
+private:
+    struct EntryCounts {
+        double calls = 0;
+        AllocCounts counts;
+    };
+
+    static std::atomic<bool> _enabled;
+    static std::atomic<long long> _heap_allocs;
+    static std::atomic<long long> _heap_bytes;
+    static double _sexps;
+    static double _sexp_bytes;
+    static double _gcs;
+
+    static SEXP _sentinel;         // weak reference to an otherwise unreachable key
+    static bool _sentinel_fired;   // a collection was counted since it was made
+
+    static std::map<std::string, EntryCounts> _entries;
+    static double _n_mutants;
+    static AllocCounts _mutant_total;
+    static AllocCounts _mutant_max;
+
+    static void countSexp(SEXP x, bool deep);
+    static void countNodes(SEXP call);
+    static void poll();
+    static void arm();
+    static void disarm();
+};
+
+// Attributes what one call of an entry point allocates to it. Construct it
+// first thing in the entry point, while only the arguments are live, and
+// return through done(), which checks for a collection while the result is
+// protected. A call that leaves otherwise is recorded without that check.
+class AllocScope {
+public:
+    explicit AllocScope(const char *entry)
+        : _entry(entry), _active(AllocStats::enabled())
+    {
+        if (_active)
+            _start = AllocStats::start();
+    }
+
+    ~AllocScope()
+    {
+        if (_active && AllocStats::enabled())
+            AllocStats::recordEntry(_entry, AllocStats::now() - _start);
+    }
+
+    SEXP done(SEXP res)
+    {
+        if (_active && AllocStats::enabled())
+            AllocStats::recordEntry(_entry, AllocStats::finish(res) - _start);
+        _active = false;
+        return res;
+    }
+
+    AllocScope(const AllocScope&) = delete;
+    AllocScope& operator=(const AllocScope&) = delete;
+
+private:
+    const char *_entry;
+    bool _active;
+    AllocCounts _start;
+};
+
+#endif // ALLOC_STATS_H
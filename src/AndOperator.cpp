@@ -1 +0,0 @@
-#include "AndOperator.hpp"
\ No newline at end of file
@@ -0,0 +1,110 @@
+// AstHash.cpp
+
+#include <cstdio>
+#include <cstring>
+#include "AstHash.hpp"
+#include "AllocStats.hpp"
+
+static inline std::uint64_t mix(std::uint64_t h, std::uint64_t v)
+{
+    // splitmix64 finaliser over the combined state
+    std::uint64_t z = h ^ (v + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2));
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+static std::uint64_t hashBytes(std::uint64_t h, const void *data, size_t n)
+{
+    // FNV-1a
+    const unsigned char *p = static_cast<const unsigned char *>(data);
+    for (size_t i = 0; i < n; ++i) {
+        h ^= p[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+static std::uint64_t hashString(SEXP charsxp)
+{
+    if (charsxp == NA_STRING)
+        return 0x5bd1e995ULL;
+    const char *s = CHAR(charsxp);
+    return hashBytes(0xcbf29ce484222325ULL, s, std::strlen(s));
+}
+
+std::uint64_t AstHasher::hashNode(SEXP x, bool remember)
+{
+    // the srcref a parse with keep.source stores in `function` calls is
+    // position data, hashed like the NULL a parse without it stores
+    const SEXPTYPE type = (TYPEOF(x) == INTSXP && Rf_inherits(x, "srcref")) ? NILSXP : TYPEOF(x);
+    std::uint64_t h = mix(0x243f6a8885a308d3ULL, type);
+
+    switch (type) {
+    case NILSXP:
+        return h;
+    case SYMSXP:
+        return mix(h, hashString(PRINTNAME(x)));
+    case LANGSXP:
+    case LISTSXP: {
+        if (type == LANGSXP) {
+            auto it = _memo.find(x);
+            if (it != _memo.end())
+                return it->second;
+        }
+        for (SEXP cell = x; cell != R_NilValue; cell = CDR(cell)) {
+            h = mix(h, hashNode(CAR(cell), remember));
+            if (TAG(cell) != R_NilValue)
+                h = mix(h, hashString(PRINTNAME(TAG(cell))));
+        }
+        if (type == LANGSXP && remember && _memo.emplace(x, h).second)
+            AllocStats::node<std::pair<const SEXP, std::uint64_t>>();
+        return h;
+    }
+    case LGLSXP:
+    case INTSXP:
+        h = mix(h, XLENGTH(x));
+        return hashBytes(h, INTEGER(x), XLENGTH(x) * sizeof(int));
+    case REALSXP:
+        h = mix(h, XLENGTH(x));
+        return hashBytes(h, REAL(x), XLENGTH(x) * sizeof(double));
+    case CPLXSXP:
+        h = mix(h, XLENGTH(x));
+        return hashBytes(h, COMPLEX(x), XLENGTH(x) * sizeof(Rcomplex));
+    case STRSXP:
+        h = mix(h, XLENGTH(x));
+        for (R_xlen_t i = 0; i < XLENGTH(x); ++i)
+            h = mix(h, hashString(STRING_ELT(x, i)));
+        return h;
+    case VECSXP:
+    case EXPRSXP:
+        h = mix(h, XLENGTH(x));
+        for (R_xlen_t i = 0; i < XLENGTH(x); ++i)
+            h = mix(h, hashNode(VECTOR_ELT(x, i), remember));
+        return h;
+    default:
+        // closures, environments, ... are not written in source code
+        return h;
+    }
+}
+
+std::uint64_t AstHasher::programHash(const std::vector<std::uint64_t>& exprs)
+{
+    std::uint64_t program = 0;
+    for (size_t i = 0; i < exprs.size(); ++i)
+        program += mix(i + 1, exprs[i]);
+    return program;
+}
+
+std::uint64_t AstHasher::substitute(std::uint64_t program, int index,
+                                    std::uint64_t old_hash, std::uint64_t new_hash)
+{
+    return program - mix(index + 1, old_hash) + mix(index + 1, new_hash);
+}
+
+std::string AstHasher::hex(std::uint64_t h)
+{
+    char buf[17];
+    std::snprintf(buf, sizeof(buf), "%016llx", static_cast<unsigned long long>(h));
+    return buf;
+}
@@ -0,0 +1,49 @@
+// AstHash.h
+#ifndef AST_HASH_H
+#define AST_HASH_H
+
+#include <cpp11.hpp>
+#include <R.h>
+#include <Rinternals.h>
+
+// Undefine the 'length' macro defined by Rinternals.h to avoid conflicts with the C++ standard library
+#undef length
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Structural 64-bit hash of R code. Two expressions hash alike when they
+// have the same shape, symbols, argument names and constants; attributes
+// such as srcrefs are ignored.
+//
+// Subtrees of an indexed expression are remembered by pointer, so hashing a
+// mutant that shares structure with it only walks the copied path. Only the
+// indexed expression is remembered: mutants are short-lived and their cells
+// may be reused by the allocator.
+class AstHasher {
+public:
+    AstHasher() = default;
+    ~AstHasher() = default;
+
+    // Hash `expr` and remember all of its calls
+    std::uint64_t index(SEXP expr) { return hashNode(expr, true); }
+    // Hash `expr`, reusing the remembered calls it shares with indexed trees
+    std::uint64_t hash(SEXP expr) { return hashNode(expr, false); }
+
+    // Hash of a whole file from the hashes of its top-level expressions. It is
+    // a sum of per-position terms, so replacing one expression is O(1).
+    static std::uint64_t programHash(const std::vector<std::uint64_t>& exprs);
+    static std::uint64_t substitute(std::uint64_t program, int index,
+                                    std::uint64_t old_hash, std::uint64_t new_hash);
+
+    static std::string hex(std::uint64_t h);
+
+private:
+    std::unordered_map<SEXP, std::uint64_t> _memo;
+
+    std::uint64_t hashNode(SEXP x, bool remember);
+};
+
+#endif // AST_HASH_H
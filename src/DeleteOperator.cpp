@@ -1 +0,0 @@
-#include "DeleteOperator.hpp"
\ No newline at end of file
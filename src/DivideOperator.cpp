@@ -1 +0,0 @@
-#include "DivideOperator.hpp"
\ No newline at end of file
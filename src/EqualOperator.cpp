@@ -1 +0,0 @@
-#include "EqualOperator.hpp"
\ No newline at end of file
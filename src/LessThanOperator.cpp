@@ -1 +0,0 @@
-#include "LessThanOperator.hpp"
\ No newline at end of file
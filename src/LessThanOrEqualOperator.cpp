@@ -1 +0,0 @@
-#include "LessThanOrEqualOperator.hpp"
\ No newline at end of file
@@ -1 +0,0 @@
-#include "LogicalAndOperator.hpp"
\ No newline at end of file
@@ -1 +0,0 @@
-#include "LogicalOrOperator.hpp"
\ No newline at end of file
@@ -1 +0,0 @@
-#include "MinusOperator.hpp"
\ No newline at end of file
@@ -1 +0,0 @@
-#include "MoreThanOperator.hpp"
\ No newline at end of file
@@ -1 +0,0 @@
-#include "MoreThanOrEqualOperator.hpp"
\ No newline at end of file
@@ -1 +0,0 @@
-#include "MultiplyOperator.hpp"
\ No newline at end of file
@@ -0,0 +1,119 @@
+// MutantSampler.cpp
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <numeric>
+#include <random>
+#include <utility>
+#include "MutantSampler.hpp"
+
+// Uniform draw in [0, bound). The modulo keeps the stream identical on every
+// platform, unlike std::uniform_int_distribution; its bias is negligible for
+// site counts.
+static std::size_t draw(std::mt19937_64& rng, std::size_t bound)
+{
+    return static_cast<std::size_t>(rng() % bound);
+}
+
+// Move `k` random elements of `v` to its front (partial Fisher-Yates)
+static void shuffleFront(std::vector<int>& v, int k, std::mt19937_64& rng)
+{
+    for (int i = 0; i < k; ++i) {
+        const std::size_t j = i + draw(rng, v.size() - i);
+        std::swap(v[i], v[j]);
+    }
+}
+
+SampleStrategy MutantSampler::strategyFromR(SEXP strategy)
+{
+    if (strategy == R_NilValue)
+        return SampleStrategy::Uniform;
+    if (TYPEOF(strategy) != STRSXP || Rf_length(strategy) != 1)
+        Rf_error("'strategy' must be one of \"uniform\", \"type\" or \"function\".");
+
+    const char *name = CHAR(STRING_ELT(strategy, 0));
+    if (std::strcmp(name, "uniform") == 0)  return SampleStrategy::Uniform;
+    if (std::strcmp(name, "type") == 0)     return SampleStrategy::PerType;
+    if (std::strcmp(name, "function") == 0) return SampleStrategy::PerFunction;
+    Rf_error("Unknown sampling strategy '%s'.", name);
+}
+
+std::vector<int> MutantSampler::select(const std::vector<int>& strata,
+                                       std::vector<double> *weight) const
+{
+    const int n = static_cast<int>(strata.size());
+    std::vector<int> picked;
+
+    if (_budget < 0 || _budget >= n) {
+        picked.resize(n);
+        std::iota(picked.begin(), picked.end(), 0);
+        if (weight) weight->assign(n, 1.0);
+        return picked;
+    }
+
+    std::mt19937_64 rng(_seed);
+
+    // members of every stratum in candidate order; the map keeps the strata
+    // in a fixed order so the draws are reproducible
+    std::map<int, std::vector<int>> members;
+    for (int i = 0; i < n; ++i)
+        members[strata[i]].push_back(i);
+    std::vector<std::vector<int> *> groups;
+    for (auto& kv : members)
+        groups.push_back(&kv.second);
+    const int n_groups = static_cast<int>(groups.size());
+
+    std::vector<int> quota(n_groups, 0);
+    if (n_groups == 1) {
+        quota[0] = _budget;
+    } else if (_budget < n_groups) {
+        // not every stratum can be represented: draw which ones are
+        std::vector<int> order(n_groups);
+        std::iota(order.begin(), order.end(), 0);
+        shuffleFront(order, _budget, rng);
+        for (int k = 0; k < _budget; ++k)
+            quota[order[k]] = 1;
+    } else {
+        // one per stratum, the rest in proportion to what every stratum has left
+        const int rest = _budget - n_groups;
+        const int left = n - n_groups;
+        int assigned = 0;
+        std::vector<std::pair<double, int>> remainders;
+        for (int g = 0; g < n_groups; ++g) {
+            const double share = left > 0
+                ? static_cast<double>(rest) * (groups[g]->size() - 1) / left : 0.0;
+            const int whole = static_cast<int>(std::floor(share));
+            quota[g] = 1 + whole;
+            assigned += whole;
+            remainders.emplace_back(share - whole, g);
+        }
+        std::stable_sort(remainders.begin(), remainders.end(),
+                         [](const std::pair<double, int>& a, const std::pair<double, int>& b) {
+                             return a.first > b.first;
+                         });
+        for (int k = 0; k < rest - assigned; ++k)
+            ++quota[remainders[k].second];
+    }
+
+    std::vector<std::pair<int, double>> chosen;
+    chosen.reserve(_budget);
+    for (int g = 0; g < n_groups; ++g) {
+        if (quota[g] == 0) continue;
+        std::vector<int>& group = *groups[g];
+        shuffleFront(group, quota[g], rng);
+        const double w = static_cast<double>(group.size()) / quota[g];
+        for (int k = 0; k < quota[g]; ++k)
+            chosen.emplace_back(group[k], w);
+    }
+    std::sort(chosen.begin(), chosen.end());
+
+    picked.reserve(chosen.size());
+    if (weight) weight->clear();
+    for (const auto& c : chosen) {
+        picked.push_back(c.first);
+        if (weight) weight->push_back(c.second);
+    }
+    return picked;
+}
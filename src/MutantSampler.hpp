@@ -0,0 +1,48 @@
+// MutantSampler.h
+#ifndef MUTANT_SAMPLER_H
+#define MUTANT_SAMPLER_H
+
+#include <R.h>
+#include <Rinternals.h>
+
+// Undefine the 'length' macro defined by Rinternals.h to avoid conflicts with the C++ standard library
+#undef length
+
+#include <cstdint>
+#include <vector>
+
+// How a mutant budget is spread over the candidate sites
+enum class SampleStrategy : std::uint8_t {
+    Uniform,      // every site equally likely
+    PerType,      // stratified by mutation operator
+    PerFunction   // stratified by top-level expression
+};
+
+// Picks at most `budget` of n candidates, reproducibly for a given seed.
+//
+// Stratified strategies give every stratum one mutant first (strata drawn at
+// random when the budget is smaller than their number) and split the rest in
+// proportion to the stratum sizes by largest remainder. Within a stratum the
+// mutants are drawn uniformly. Each picked mutant stands for
+// `weight` = stratum size / stratum quota candidates, so a weighted mean of
+// the outcomes estimates the score of the full set.
+class MutantSampler {
+public:
+    // A negative budget selects every candidate
+    MutantSampler(int budget, std::uint64_t seed) : _budget(budget), _seed(seed) {}
+    ~MutantSampler() = default;
+
+    // "uniform", "type" or "function"; NULL means uniform
+    static SampleStrategy strategyFromR(SEXP strategy);
+
+    // Indices of the selected candidates in increasing order. `strata` holds
+    // one stratum id per candidate; pass all zeros for uniform sampling.
+    std::vector<int> select(const std::vector<int>& strata,
+                            std::vector<double> *weight = nullptr) const;
+
+private:
+    int _budget;
+    std::uint64_t _seed;
+};
+
+#endif // MUTANT_SAMPLER_H
@@ -0,0 +1,127 @@
+// MutantStream.cpp
+
+#include <numeric>
+#include "ASTHandler.hpp"
+#include "ParseDataIndex.hpp"
+#include "SiteRules.hpp"
+#include "MutantStream.hpp"
+#include "AllocStats.hpp"
+
+MutantStream::MutantStream(SEXP exprs, SEXP src_ref, const std::vector<bool>& inside_block,
+                           ValidationMode mode)
+    : _exprs(exprs), _mode(mode)
+{
+    const int n_expr = Rf_length(exprs);
+    const ParseDataIndex index(exprs);
+
+    // every distinct program is produced once; the unmutated file counts as seen
+    _expr_hashes.resize(n_expr);
+    for (int i = 0; i < n_expr; ++i)
+        _expr_hashes[i] = _hasher.index(VECTOR_ELT(exprs, i));
+    _program = AstHasher::programHash(_expr_hashes);
+    _seen.insert(_program);
+    AllocStats::node<std::uint64_t>();
+
+    _tables.reserve(n_expr);
+    _first_row.reserve(n_expr);
+    int row = 0;
+    for (int i = 0; i < n_expr; ++i) {
+        ASTHandler astHandler;
+        _tables.push_back(astHandler.gatherOperators(VECTOR_ELT(exprs, i),
+                                                     VECTOR_ELT(src_ref, i),
+                                                     inside_block[i], &index));
+        const SiteTable &ops = _tables.back();
+        std::vector<SiteRuling> rulings = SiteRules().check(VECTOR_ELT(exprs, i), ops);
+        AllocStats::buffer(rulings);
+        for (int j = 0; j < ops.size(); ++j)
+            if (rulings[j].verdict != SiteVerdict::Equivalent)
+                _candidates.emplace_back(i, j);
+        _first_row.push_back(row);
+        row += ops.size();
+    }
+
+    _order.resize(_candidates.size());
+    std::iota(_order.begin(), _order.end(), 0);
+
+    AllocStats::buffer(_expr_hashes);
+    AllocStats::buffer(_tables);
+    AllocStats::buffer(_first_row);
+    AllocStats::buffer(_candidates);
+    AllocStats::buffer(_order);
+}
+
+void MutantStream::sample(const MutantSampler& sampler, SampleStrategy how)
+{
+    std::vector<int> strata;
+    strata.reserve(_order.size());
+    for (int k : _order) {
+        const int i = _candidates[k].first;
+        strata.push_back(how == SampleStrategy::PerType
+                             ? static_cast<int>(_tables[i].kind[_candidates[k].second]) :
+                         how == SampleStrategy::PerFunction ? i : 0);
+    }
+
+    std::vector<int> order;
+    for (int k : sampler.select(strata))
+        order.push_back(_order[k]);
+    AllocStats::buffer(strata);
+    AllocStats::buffer(order);
+    _order.swap(order);
+    _cursor = 0;
+}
+
+void MutantStream::restrict(const std::vector<int>& rows)
+{
+    // candidate of every site row; -1 for rows that are never built
+    const int n_rows = _first_row.empty() ? 0 : _first_row.back() + _tables.back().size();
+    std::vector<int> by_row(n_rows, -1);
+    AllocStats::buffer(by_row);
+    for (int k = 0; k < candidates(); ++k)
+        by_row[_first_row[_candidates[k].first] + _candidates[k].second] = k;
+
+    const std::size_t capacity = _order.capacity();
+    _order.clear();
+    for (int r : rows)
+        if (r >= 0 && r < n_rows && by_row[r] >= 0)
+            _order.push_back(by_row[r]);
+    AllocStats::buffer(_order, capacity);
+    _cursor = 0;
+}
+
+bool MutantStream::next(StreamedMutant *out)
+{
+    const MutantValidator validator(_mode);
+    // what building the mutant took, candidates dropped on the way included;
+    // collections are only looked for at entry points, not per mutant
+    const bool counting = AllocStats::enabled();
+    const AllocCounts start = counting ? AllocStats::now() : AllocCounts();
+    while (_cursor < static_cast<int>(_order.size())) {
+        // advance first: a failing validator must not retry the same site
+        const int k = _order[_cursor++];
+        const int i = _candidates[k].first;
+        const int j = _candidates[k].second;
+        SEXP cur_expr = VECTOR_ELT(_exprs, i);
+
+        auto result = _mutator.applyMutation(cur_expr, _tables[i], j);
+        if (!result.second)
+            continue;
+        SEXP mut = result.first;               // left protected by the mutator
+
+        const std::uint64_t program =
+            AstHasher::substitute(_program, i, _expr_hashes[i], _hasher.hash(mut));
+        // drop programs seen before and invalid mutants
+        const bool is_new = _seen.insert(program).second;
+        if (is_new)
+            AllocStats::node<std::uint64_t>();
+        if (!is_new || !validator.isValid(_exprs, i, mut)) {
+            UNPROTECT(1);
+            continue;
+        }
+
+        *out = {mut, i, _first_row[i] + j, program};
+        if (counting)
+            AllocStats::recordMutant(AllocStats::now() - start);
+        return true;
+    }
+    return false;
+}
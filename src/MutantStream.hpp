@@ -0,0 +1,78 @@
+// MutantStream.h
+#ifndef MUTANT_STREAM_H
+#define MUTANT_STREAM_H
+
+#include "SiteTable.hpp"
+#include "AstHash.hpp"
+#include "MutantSampler.hpp"
+#include "MutantValidator.hpp"
+#include "Mutator.hpp"
+#include <R.h>
+#include <Rinternals.h>
+
+// Undefine the 'length' macro defined by Rinternals.h to avoid conflicts with the C++ standard library
+#undef length
+
+#include <cstdint>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+// One mutant produced by a stream. `mutant` is the replacement of expression
+// `expr_index` and is left protected, like the results of the Mutator.
+struct StreamedMutant {
+    SEXP mutant;
+    int expr_index;          // 0-based top-level expression
+    int site_row;            // 0-based row of the file's site table
+    std::uint64_t program;   // hash of the whole mutated file
+};
+
+// Lazily builds the mutants of a parsed file. The sites of every expression
+// are gathered up front, but a mutant is only built, deduplicated and
+// validated when it is asked for, so callers can start using the first ones
+// while the rest are still pending and only hold the ones they keep.
+//
+// Site rows are numbered like the rows of C_mutation_sites. Sites the static
+// rules prove equivalent are never candidates. The stream keeps pointers
+// into `exprs`: the caller has to keep it alive for the stream's lifetime.
+class MutantStream {
+public:
+    MutantStream(SEXP exprs, SEXP src_ref, const std::vector<bool>& inside_block,
+                 ValidationMode mode);
+    ~MutantStream() = default;
+
+    MutantStream(const MutantStream&) = delete;
+    MutantStream& operator=(const MutantStream&) = delete;
+
+    // Keep at most `sampler`'s budget of the candidates, stratified per `how`
+    void sample(const MutantSampler& sampler, SampleStrategy how);
+    // Keep only the candidates at these 0-based site rows, in this order
+    void restrict(const std::vector<int>& rows);
+
+    // Build the next valid mutant of a program not produced before. Returns
+    // false once the candidates are exhausted; no mutant is protected then.
+    bool next(StreamedMutant *out);
+
+    // Candidates not tried yet; some of them may still be dropped
+    int remaining() const { return static_cast<int>(_order.size()) - _cursor; }
+    // Candidates before sampling or restricting
+    int candidates() const { return static_cast<int>(_candidates.size()); }
+
+private:
+    SEXP _exprs;
+    ValidationMode _mode;
+    Mutator _mutator;
+    AstHasher _hasher;
+
+    std::vector<SiteTable> _tables;
+    std::vector<std::pair<int, int>> _candidates;   // (expression, site)
+    std::vector<int> _first_row;                    // site row of every expression's site 0
+    std::vector<int> _order;                        // candidates still to try, in order
+    int _cursor = 0;
+
+    std::vector<std::uint64_t> _expr_hashes;
+    std::uint64_t _program = 0;
+    std::unordered_set<std::uint64_t> _seen;
+};
+
+#endif // MUTANT_STREAM_H
@@ -0,0 +1,133 @@
+// MutantValidator.cpp
+
+#include <cstring>
+#include "MutantValidator.hpp"
+
+static struct ValidatorSyms {
+    SEXP s_function = Rf_install("function");
+    SEXP s_if       = Rf_install("if");
+    SEXP s_for      = Rf_install("for");
+    SEXP s_while    = Rf_install("while");
+    SEXP s_repeat   = Rf_install("repeat");
+    SEXP s_paren    = Rf_install("(");
+    SEXP s_assign   = Rf_install("<-");   SEXP s_assign2 = Rf_install("<<-");
+    SEXP s_equals   = Rf_install("=");
+    SEXP s_plus     = Rf_install("+");    SEXP s_minus   = Rf_install("-");
+    SEXP s_not      = Rf_install("!");
+    SEXP s_mul      = Rf_install("*");    SEXP s_div     = Rf_install("/");
+    SEXP s_pow      = Rf_install("^");
+    SEXP s_eq       = Rf_install("==");   SEXP s_neq     = Rf_install("!=");
+    SEXP s_lt       = Rf_install("<");    SEXP s_gt      = Rf_install(">");
+    SEXP s_le       = Rf_install("<=");   SEXP s_ge      = Rf_install(">=");
+    SEXP s_and      = Rf_install("&");    SEXP s_or      = Rf_install("|");
+    SEXP s_land     = Rf_install("&&");   SEXP s_lor     = Rf_install("||");
+} VSYM;
+
+ValidationMode MutantValidator::modeFromR(SEXP mode)
+{
+    if (mode == R_NilValue)
+        return ValidationMode::Syntax;
+    if (TYPEOF(mode) != STRSXP || Rf_length(mode) != 1)
+        Rf_error("'validate' must be one of \"syntax\", \"eval\" or \"none\".");
+
+    const char *name = CHAR(STRING_ELT(mode, 0));
+    if (std::strcmp(name, "syntax") == 0) return ValidationMode::Syntax;
+    if (std::strcmp(name, "eval") == 0)   return ValidationMode::Eval;
+    if (std::strcmp(name, "none") == 0)   return ValidationMode::None;
+    Rf_error("Unknown validation mode '%s'.", name);
+}
+
+bool MutantValidator::isValid(SEXP exprs, int expr_index, SEXP replacement) const
+{
+    switch (_mode) {
+    case ValidationMode::None:
+        return true;
+    case ValidationMode::Eval:
+        return evaluatesCleanly(exprs, expr_index, replacement);
+    case ValidationMode::Syntax:
+    default:
+        return isWellFormed(replacement, VECTOR_ELT(exprs, expr_index));
+    }
+}
+
+bool MutantValidator::evaluatesCleanly(SEXP exprs, int expr_index, SEXP replacement) const
+{
+    // a fresh child of the global environment per mutant, so definitions made
+    // by one mutant never leak into the next one or into the session
+    SEXP env = PROTECT(R_NewEnv(R_GlobalEnv, TRUE, 29));
+
+    const int n_expr = Rf_length(exprs);
+    bool ok = true;
+    for (int k = 0; k < n_expr && ok; ++k) {
+        int error = 0;
+        R_tryEvalSilent(k == expr_index ? replacement : VECTOR_ELT(exprs, k), env, &error);
+        ok = (error == 0);
+    }
+    UNPROTECT(1);
+    return ok;
+}
+
+bool MutantValidator::hasValidArity(SEXP call) const
+{
+    SEXP fun = CAR(call);
+    if (TYPEOF(fun) != SYMSXP)
+        return true;
+
+    const int n_args = Rf_length(CDR(call));
+
+    if (fun == VSYM.s_function) {
+        SEXP formals = CADR(call);
+        return n_args >= 2 && n_args <= 3 &&
+               (formals == R_NilValue || TYPEOF(formals) == LISTSXP);
+    }
+    if (fun == VSYM.s_if)
+        return n_args == 2 || n_args == 3;
+    if (fun == VSYM.s_for)
+        return n_args == 3 && TYPEOF(CADR(call)) == SYMSXP;
+    if (fun == VSYM.s_while)
+        return n_args == 2;
+    if (fun == VSYM.s_repeat || fun == VSYM.s_paren || fun == VSYM.s_not)
+        return n_args == 1;
+    if (fun == VSYM.s_assign || fun == VSYM.s_assign2 || fun == VSYM.s_equals) {
+        if (n_args != 2) return false;
+        SEXP lhs = CADR(call);
+        return TYPEOF(lhs) == SYMSXP || TYPEOF(lhs) == STRSXP || TYPEOF(lhs) == LANGSXP;
+    }
+    if (fun == VSYM.s_plus || fun == VSYM.s_minus)
+        return n_args == 1 || n_args == 2;
+    if (fun == VSYM.s_mul || fun == VSYM.s_div || fun == VSYM.s_pow ||
+        fun == VSYM.s_eq  || fun == VSYM.s_neq || fun == VSYM.s_lt  ||
+        fun == VSYM.s_gt  || fun == VSYM.s_le  || fun == VSYM.s_ge  ||
+        fun == VSYM.s_and || fun == VSYM.s_or  || fun == VSYM.s_land ||
+        fun == VSYM.s_lor)
+        return n_args == 2;
+    return true;
+}
+
+bool MutantValidator::isWellFormed(SEXP mutated, SEXP original) const
+{
+    // subtrees shared with the parsed file came out of the parser and are
+    // well formed by construction
+    if (mutated == original || TYPEOF(mutated) != LANGSXP)
+        return true;
+    if (!hasValidArity(mutated))
+        return false;
+    if (TYPEOF(CAR(mutated)) == LANGSXP && !isWellFormed(CAR(mutated), R_NilValue))
+        return false;
+
+    // walk the arguments next to the original ones; a deleted argument shows
+    // up as the original list being one cell ahead
+    SEXP orig = TYPEOF(original) == LANGSXP ? CDR(original) : R_NilValue;
+    for (SEXP m = CDR(mutated); m != R_NilValue; m = CDR(m)) {
+        SEXP counterpart = R_NilValue;
+        if (orig != R_NilValue) {
+            if (CAR(m) != CAR(orig) && CDR(orig) != R_NilValue && CAR(m) == CADR(orig))
+                orig = CDR(orig);
+            counterpart = CAR(orig);
+            orig = CDR(orig);
+        }
+        if (!isWellFormed(CAR(m), counterpart))
+            return false;
+    }
+    return true;
+}
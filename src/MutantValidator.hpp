@@ -0,0 +1,37 @@
+// MutantValidator.h
+#ifndef MUTANT_VALIDATOR_H
+#define MUTANT_VALIDATOR_H
+
+#include <R.h>
+#include <Rinternals.h>
+
+// How a generated mutant is checked before it is handed back to R
+enum class ValidationMode {
+    None,    // accept every mutant
+    Syntax,  // AST well-formedness of the mutated region, no evaluation
+    Eval     // evaluate the mutated file in a fresh environment
+};
+
+// Class to Check Mutants Before They Are Kept
+class MutantValidator {
+public:
+    explicit MutantValidator(ValidationMode mode = ValidationMode::Syntax) : _mode(mode) {}
+    ~MutantValidator() = default;
+
+    // Parse the mode from R: NULL or "syntax", "eval", "none"
+    static ValidationMode modeFromR(SEXP mode);
+
+    // Is `replacement` a valid stand-in for expression expr_index of exprs
+    bool isValid(SEXP exprs, int expr_index, SEXP replacement) const;
+
+    // Check the nodes of `mutated` that are not shared with `original`
+    bool isWellFormed(SEXP mutated, SEXP original) const;
+
+private:
+    ValidationMode _mode;
+
+    bool evaluatesCleanly(SEXP exprs, int expr_index, SEXP replacement) const;
+    bool hasValidArity(SEXP call) const;
+};
+
+#endif // MUTANT_VALIDATOR_H
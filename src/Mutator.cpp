@@ -1,88 +1,213 @@
 // Mutator.cpp
 #include <sstream>
 #include <iostream>  // Needed for std::cout
+#include <algorithm>
+#include <string>
 #include "Mutator.hpp"
-#include "DeleteOperator.hpp"
+#include "AllocStats.hpp"
 
-std::pair<SEXP,bool> Mutator::applyMutation(SEXP expr, const std::vector<OperatorPos>& ops, int which)
+// Copy a single cons cell, keeping its type, tag and attributes. CAR and CDR
+// are shared with the original cell.
+static SEXP shallowCell(SEXP cell)
 {
-    if (which < 0 || which >= static_cast<int>(ops.size()))
+    SEXP copy = PROTECT(AllocStats::sexp(TYPEOF(cell) == LANGSXP ? Rf_lcons(CAR(cell), CDR(cell))
+                                                                 : Rf_cons(CAR(cell), CDR(cell))));
+    SET_TAG(copy, TAG(cell));
+    SHALLOW_DUPLICATE_ATTRIB(copy, cell);
+    UNPROTECT(1);
+    return copy;
+}
+
+static bool isPairList(SEXP x)
+{
+    return TYPEOF(x) == LANGSXP || TYPEOF(x) == LISTSXP;
+}
+
+SEXP Mutator::copyRoot(SEXP expr) const
+{
+    if (!_share_structure || !isPairList(expr))
+        return AllocStats::tree(Rf_duplicate(expr));
+    return shallowCell(expr);
+}
+
+SEXP Mutator::cellBefore(SEXP list, const SiteTable& sites, int which, int level) const
+{
+    if (!isPairList(list))
+        return R_NilValue;
+
+    // with a recorded spine the argument cell is known by pointer; without
+    // one it is found by counting path[level] cells past the function
+    const bool by_pointer = _share_structure && sites.hasSpine(which);
+    SEXP target = by_pointer ? sites.spineData(which)[level] : R_NilValue;
+    int remaining = by_pointer ? -1 : sites.pathData(which)[level];
+
+    // every cell we step through is replaced by a copy so that the cell we
+    // hand back can be modified without touching the original list
+    SEXP prev = list;
+    while (by_pointer ? CDR(prev) != target : remaining-- > 0) {
+        SEXP next = CDR(prev);
+        if (next == R_NilValue)
+            return R_NilValue;
+        if (_share_structure) {
+            next = shallowCell(next);
+            SETCDR(prev, next);
+        }
+        prev = next;
+    }
+    return prev;
+}
+
+SEXP Mutator::argumentNode(SEXP list, const SiteTable& sites, int which, int level) const
+{
+    SEXP prev = cellBefore(list, sites, which, level);
+    if (prev == R_NilValue || CDR(prev) == R_NilValue)
+        return R_NilValue;
+
+    SEXP cell = CDR(prev);
+    if (_share_structure) {
+        cell = shallowCell(cell);
+        SETCDR(prev, cell);
+    }
+    return ownChild(cell);
+}
+
+SEXP Mutator::ownChild(SEXP cell) const
+{
+    SEXP child = CAR(cell);
+    if (_share_structure && isPairList(child)) {
+        child = shallowCell(child);
+        SETCAR(cell, child);
+    }
+    return child;
+}
+
+std::pair<SEXP,bool> Mutator::applyMutation(SEXP expr, const SiteTable& sites, int which)
+{
+    if (which < 0 || which >= sites.size())
         return {R_NilValue, false};
 
-    if (dynamic_cast<DeleteOperator*>(ops[which].op.get()))
-        return applyDeleteMutation(expr, ops, which);
-    return applyFlipMutation(expr, ops, which);
+    if (sites.kind[which] == OpKind::Delete)
+        return applyDeleteMutation(expr, sites, which);
+    return applyFlipMutation(expr, sites, which);
 }
 
-std::pair<SEXP,bool> Mutator::applyFlipMutation(SEXP expr, const std::vector<OperatorPos>& ops, int which)
+// True if site a comes before site b in a pre-order walk of the expression
+static bool precedes(const SiteTable& sites, int a, int b)
 {
-    SEXP mutated = PROTECT(Rf_duplicate(expr));          // [0]
+    const int *pa = sites.pathData(a);
+    const int *pb = sites.pathData(b);
+    const int la = sites.path_length[a];
+    const int lb = sites.path_length[b];
+    for (int k = 0; k < la && k < lb; ++k)
+        if (pa[k] != pb[k])
+            return pa[k] < pb[k];
+    return la < lb;                                     // ancestors come first
+}
 
-    const OperatorPos &pos = ops[which];
-    SEXP node = mutated;
-    for (int idx : pos.path) {
-        if (node == R_NilValue || CDR(node) == R_NilValue) {
+std::pair<SEXP,bool> Mutator::applyMutations(SEXP expr, const SiteTable& sites,
+                                             const std::vector<int>& which)
+{
+    for (int w : which)
+        if (w < 0 || w >= sites.size())
+            return {R_NilValue, false};
+    if (which.size() == 1)
+        return applyMutation(expr, sites, which[0]);
+
+    std::vector<int> order(which);
+    AllocStats::buffer(order);
+    std::sort(order.begin(), order.end(), [&sites](int a, int b) {
+        if (!precedes(sites, a, b) && !precedes(sites, b, a))
+            return sites.kind[b] == OpKind::Delete && sites.kind[a] != OpKind::Delete;
+        return precedes(sites, b, a);                   // a flip before a delete of its node
+    });
+
+    // after the first mutation the recorded spine no longer belongs to the
+    // tree being mutated, so every site is found by counting along its path
+    SiteTable steps;
+    for (int w : order)
+        steps.add(sites.kind[w], sites.path(w), sites.original[w],
+                  sites.start_line[w], sites.start_col[w], sites.end_line[w], sites.end_col[w]);
+
+    SEXP mutated = expr;
+    PROTECT_INDEX ipx;
+    PROTECT_WITH_INDEX(mutated, &ipx);                  // [0]
+    std::string info;
+    for (int k = 0; k < steps.size(); ++k) {
+        auto step = applyMutation(mutated, steps, k);
+        if (!step.second) {
             UNPROTECT(1);
             return {R_NilValue, false};
         }
-        SEXP nxt = CDR(node);
-        for (int j = 0; j < idx; ++j) {
-            nxt = CDR(nxt);
-            if (nxt == R_NilValue) {
-                UNPROTECT(1);
-                return {R_NilValue, false};
-            }
+        REPROTECT(mutated = step.first, ipx);
+        UNPROTECT(1);                                   // the step's own protection
+
+        SEXP msg = Rf_getAttrib(mutated, Rf_install("mutation_info"));
+        if (TYPEOF(msg) == STRSXP && Rf_length(msg) == 1) {
+            if (!info.empty()) info += '\n';
+            info += CHAR(STRING_ELT(msg, 0));
         }
-        node = CAR(nxt);
+    }
+
+    steps.countBuffers();
+    AllocStats::text(info);
+    SEXP msg = PROTECT(AllocStats::sexp(Rf_mkString(info.c_str())));     // [1]
+    Rf_setAttrib(mutated, Rf_install("mutation_info"), msg);
+    UNPROTECT(1);                                       // drop msg, mutated still protected
+    return {mutated, true};
+}
+
+std::pair<SEXP,bool> Mutator::applyFlipMutation(SEXP expr, const SiteTable& sites, int which)
+{
+    const OpKind kind = sites.kind[which];
+    if (kind == OpKind::Delete)
+        return {R_NilValue, false};
+
+    SEXP mutated = PROTECT(copyRoot(expr));              // [0]
+
+    SEXP node = mutated;
+    for (int k = 0; k < sites.path_length[which] && node != R_NilValue; ++k)
+        node = argumentNode(node, sites, which, k);
+    if (!isPairList(node)) {
+        UNPROTECT(1);
+        return {R_NilValue, false};
     }
 
     // perform the operator‑specific flip
-    pos.op->flip(node);
+    SETCAR(node, replacementSymbol(kind));
 
     // build mutation_info string
     std::ostringstream oss;
-    oss << "\nFrom line/col: " << pos.start_line << '/' << pos.start_col << '\n'
-        << "To line/col: "   << pos.end_line   << '/' << pos.end_col   << '\n'
-        << '\'' << CHAR(PRINTNAME(pos.original_symbol)) << "' -> '"
-        << CHAR(PRINTNAME(CAR(node))) << '\'';
+    oss << "\nFrom line/col: " << sites.start_line[which] << '/' << sites.start_col[which] << '\n'
+        << "To line/col: "   << sites.end_line[which]   << '/' << sites.end_col[which]   << '\n'
+        << '\'' << opSpec(kind).symbol << "' -> '" << opSpec(kind).replacement << '\'';
+    const std::string info = oss.str();
+    AllocStats::message(info);
 
-    SEXP msg = PROTECT(Rf_mkString(oss.str().c_str())); // [1]
+    SEXP msg = PROTECT(AllocStats::sexp(Rf_mkString(info.c_str()))); // [1]
     Rf_setAttrib(mutated, Rf_install("mutation_info"), msg);
     UNPROTECT(1);                                       // drop msg, mutated still protected
     return {mutated, true};
 }
 
-std::pair<SEXP,bool> Mutator::applyDeleteMutation(SEXP expr, const std::vector<OperatorPos>& ops, int which)
+std::pair<SEXP,bool> Mutator::applyDeleteMutation(SEXP expr, const SiteTable& sites, int which)
 {
-    SEXP dup = PROTECT(Rf_duplicate(expr));             // [0]
-    const auto &pos = ops[which];
-    const auto &path = pos.path;
+    const int depth = sites.path_length[which];
+    if (depth == 0) return {R_NilValue,false};           // the root cannot be deleted
 
-    if (path.empty()) { UNPROTECT(1); return {R_NilValue,false}; }
-    if (path.size()==1 && path[0]==0) { UNPROTECT(1); return {R_NilValue,false}; }
+    SEXP dup = PROTECT(copyRoot(expr));                 // [0]
+    const std::vector<int> path = sites.path(which);
+    AllocStats::buffer(path);
 
     // navigate to parent SEXP that owns the element to delete
     SEXP parent = dup;
-    for (size_t i = 0; i + 1 < path.size(); ++i) {
-        int idx = path[i];
+    for (int k = 0; k + 1 < depth; ++k) {
         if (parent == R_NilValue || TYPEOF(parent) != LANGSXP) { UNPROTECT(1); return {R_NilValue,false}; }
-        SEXP iter = parent;
-        for (int j=0;j<idx;++j) {
-            iter = CDR(iter);
-            if (iter == R_NilValue) { UNPROTECT(1); return {R_NilValue,false}; }
-        }
-        parent = CAR(iter);
+        parent = argumentNode(parent, sites, which, k);
     }
 
-    int delIdx = path.back();
-    if (delIdx == 0) { UNPROTECT(1); return {R_NilValue,false}; }
-
     // move to the cons cell *before* the one to remove
-    SEXP prev = parent;
-    for (int i = 0; i < delIdx - 1; ++i) {
-        prev = CDR(prev);
-        if (prev == R_NilValue) { UNPROTECT(1); return {R_NilValue,false}; }
-    }
+    SEXP prev = cellBefore(parent, sites, which, depth - 1);
+    if (prev == R_NilValue) { UNPROTECT(1); return {R_NilValue,false}; }
 
     if (CDR(prev) != R_NilValue) {
         SETCDR(prev, CDDR(prev));   // skip over the element to delete
@@ -91,9 +216,11 @@ std::pair<SEXP,bool> Mutator::applyDeleteMutation(SEXP expr, const std::vector<O
         std::ostringstream oss;
         oss << "Deleting node at path: ";
         for (size_t i=0;i<path.size();++i) { oss<<path[i]; if(i+1<path.size()) oss<<'/'; }
-        oss << "\nFrom line/col: " << pos.start_line << '/' << pos.start_col << '\n'
-            << "To line/col: "   << pos.end_line   << '/' << pos.end_col   << '\n';
-        SEXP msg = PROTECT(Rf_mkString(oss.str().c_str())); // [1]
+        oss << "\nFrom line/col: " << sites.start_line[which] << '/' << sites.start_col[which] << '\n'
+            << "To line/col: "   << sites.end_line[which]   << '/' << sites.end_col[which]   << '\n';
+        const std::string info = oss.str();
+        AllocStats::message(info);
+        SEXP msg = PROTECT(AllocStats::sexp(Rf_mkString(info.c_str()))); // [1]
         Rf_setAttrib(dup, Rf_install("mutation_info"), msg);
         UNPROTECT(1);                                   // drop msg, dup still protected
         return {dup, true};
@@ -2,7 +2,7 @@
 #ifndef MUTATOR_H
 #define MUTATOR_H
 
-#include "OperatorPos.hpp"
+#include "SiteTable.hpp"
 #include <R.h>
 #include <Rinternals.h>
 #include <vector>
@@ -10,16 +10,37 @@
 // Class to Handle Mutation Application
 class Mutator {
 public:
-    Mutator() = default;
+    // With share_structure (the default) a mutant only copies the cons cells on
+    // the path from the root to the mutated node and shares every untouched
+    // subtree with the original expression. Without it the whole expression is
+    // duplicated before mutating.
+    explicit Mutator(bool share_structure = true) : _share_structure(share_structure) {}
     ~Mutator() = default;
 
-    // Apply a given subset of operator flips to the original expression
-    //SEXP applyMutations(SEXP expr, const std::vector<OperatorPos>& ops, int mask);
-    std::pair<SEXP, bool> applyMutation(SEXP expr, const std::vector<OperatorPos>& ops,int whichOpIndex);
+    std::pair<SEXP, bool> applyMutation(SEXP expr, const SiteTable& sites, int whichOpIndex);
 
-    std::pair<SEXP, bool> applyFlipMutation(SEXP expr, const std::vector<OperatorPos>& ops,int whichOpIndex);
+    // Apply several sites of the expression to one higher-order mutant. The
+    // sites are applied in reverse pre-order, so no mutation moves the node a
+    // later one is found at; a site inside a deleted subtree goes with it.
+    // Fails if any of the sites cannot be applied.
+    std::pair<SEXP, bool> applyMutations(SEXP expr, const SiteTable& sites,
+                                         const std::vector<int>& which);
 
-    std::pair<SEXP, bool> applyDeleteMutation(SEXP expr, const std::vector<OperatorPos>& ops, int whichOpIndex);
+    std::pair<SEXP, bool> applyFlipMutation(SEXP expr, const SiteTable& sites, int whichOpIndex);
+
+    std::pair<SEXP, bool> applyDeleteMutation(SEXP expr, const SiteTable& sites, int whichOpIndex);
+
+private:
+    bool _share_structure;
+
+    // Private copy of the root that can be mutated without touching expr
+    SEXP copyRoot(SEXP expr) const;
+    // Private cell preceding the argument of `list` at `level` of the site's path
+    SEXP cellBefore(SEXP list, const SiteTable& sites, int which, int level) const;
+    // Private copy of the argument of `list` at `level` of the site's path
+    SEXP argumentNode(SEXP list, const SiteTable& sites, int which, int level) const;
+    // Make the node stored in `cell` private and return it
+    SEXP ownChild(SEXP cell) const;
 };
 
 #endif // MUTATOR_H
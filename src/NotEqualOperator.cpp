@@ -1 +0,0 @@
-#include "NotEqualOperator.hpp"
\ No newline at end of file
@@ -1,7 +0,0 @@
-#include "Operator.hpp"
-
-// Since Operator is an abstract base class, most functionality is in the header.
-// This file provides an implementation for any non-inline methods that might be needed.
-
-// Currently there are no non-inline methods that need implementation here.
-// This file exists to satisfy the build process that expects a .cpp file for each .hpp file. 
\ No newline at end of file
@@ -1 +0,0 @@
-#include "OrOperator.hpp"
\ No newline at end of file
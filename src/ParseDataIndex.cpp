@@ -0,0 +1,201 @@
+// ParseDataIndex.cpp
+
+#include <algorithm>
+#include <cstring>
+#include "ParseDataIndex.hpp"
+#include "AllocStats.hpp"
+
+// Rows of the parse data matrix, see utils::getParseData
+enum { PD_LINE1, PD_COL1, PD_LINE2, PD_COL2, PD_TERMINAL, PD_TOKEN, PD_ID, PD_PARENT, PD_ROWS };
+
+ParseDataIndex::Token ParseDataIndex::classify(const char *token)
+{
+    static const char *operators[] = {
+        "'+'", "'-'", "'*'", "'/'", "EQ", "NE", "LT", "GT", "LE", "GE",
+        "AND", "OR", "AND2", "OR2"
+    };
+
+    if (std::strcmp(token, "expr") == 0 || std::strcmp(token, "equal_assign") == 0 ||
+        std::strcmp(token, "expr_or_assign_or_help") == 0)
+        return Token::Expr;
+    for (const char *op : operators)
+        if (std::strcmp(token, op) == 0)
+            return Token::Operator;
+    if (std::strcmp(token, "'('") == 0)          return Token::LeftParen;
+    if (std::strcmp(token, "RIGHT_ASSIGN") == 0) return Token::RightAssign;
+    if (std::strcmp(token, "PIPE") == 0)         return Token::Pipe;
+    if (std::strcmp(token, "forcond") == 0)      return Token::ForCond;
+    return Token::Other;
+}
+
+ParseDataIndex::ParseDataIndex(SEXP exprs)
+{
+    SEXP srcfile = Rf_getAttrib(exprs, Rf_install("srcfile"));
+    if (TYPEOF(srcfile) != ENVSXP)
+        return;
+
+    SEXP data = Rf_findVarInFrame(srcfile, Rf_install("parseData"));
+    if (TYPEOF(data) != INTSXP || Rf_length(data) % PD_ROWS != 0)
+        return;
+    SEXP tokens = Rf_getAttrib(data, Rf_install("tokens"));
+    const int n = Rf_length(data) / PD_ROWS;
+    if (TYPEOF(tokens) != STRSXP || Rf_length(tokens) != n)
+        return;
+
+    const int *pd = INTEGER(data);
+    int max_id = 0;
+    for (int r = 0; r < n; ++r)
+        max_id = std::max(max_id, pd[r * PD_ROWS + PD_ID]);
+
+    std::vector<int> row_of_id(max_id + 1, -1);
+    _line1.resize(n); _col1.resize(n); _line2.resize(n); _col2.resize(n);
+    _token.resize(n);
+    for (int r = 0; r < n; ++r) {
+        const int *col = pd + r * PD_ROWS;
+        _line1[r] = col[PD_LINE1]; _col1[r] = col[PD_COL1];
+        _line2[r] = col[PD_LINE2]; _col2[r] = col[PD_COL2];
+        _token[r] = classify(CHAR(STRING_ELT(tokens, r)));
+        row_of_id[col[PD_ID]] = r;
+    }
+
+    // group rows under their parent (counting sort), then order siblings
+    // by position since the table is in creation order
+    std::vector<int> parent_row(n, -1);
+    _child_offset.assign(n + 1, 0);
+    for (int r = 0; r < n; ++r) {
+        const int parent = pd[r * PD_ROWS + PD_PARENT];
+        if (parent > 0 && parent <= max_id && row_of_id[parent] >= 0) {
+            parent_row[r] = row_of_id[parent];
+            ++_child_offset[parent_row[r] + 1];
+        } else if (parent == 0 && _token[r] == Token::Expr) {
+            _top_level[{_line1[r], _col1[r]}] = r;
+        }
+    }
+    for (int r = 0; r < n; ++r)
+        _child_offset[r + 1] += _child_offset[r];
+
+    _children.resize(_child_offset[n]);
+    std::vector<int> fill(_child_offset.begin(), _child_offset.end() - 1);
+    for (int r = 0; r < n; ++r)
+        if (parent_row[r] >= 0)
+            _children[fill[parent_row[r]]++] = r;
+
+    for (int r = 0; r < n; ++r) {
+        std::sort(_children.begin() + _child_offset[r], _children.begin() + _child_offset[r + 1],
+                  [this](int a, int b) {
+                      return _line1[a] != _line1[b] ? _line1[a] < _line1[b] : _col1[a] < _col1[b];
+                  });
+    }
+
+    AllocStats::buffer(row_of_id);
+    AllocStats::buffer(parent_row);
+    AllocStats::buffer(fill);
+    AllocStats::buffer(_line1);
+    AllocStats::buffer(_col1);
+    AllocStats::buffer(_line2);
+    AllocStats::buffer(_col2);
+    AllocStats::buffer(_token);
+    AllocStats::buffer(_child_offset);
+    AllocStats::buffer(_children);
+    for (std::size_t k = 0; k < _top_level.size(); ++k)
+        AllocStats::node<std::pair<const std::pair<int, int>, int>>();
+}
+
+int ParseDataIndex::topLevelNode(SEXP src_ref) const
+{
+    if (empty() || TYPEOF(src_ref) != INTSXP || Rf_length(src_ref) < 4)
+        return -1;
+
+    // srcref columns are elements 5 and 6 when present, bytes otherwise
+    const int *p = INTEGER(src_ref);
+    const bool has_cols = Rf_length(src_ref) >= 6;
+    auto it = _top_level.find({p[0], has_cols ? p[4] : p[1]});
+    if (it == _top_level.end() || _line2[it->second] != p[2])
+        return -1;
+    return it->second;
+}
+
+int ParseDataIndex::firstChild(int node, Token token) const
+{
+    for (int c = _child_offset[node]; c < _child_offset[node + 1]; ++c)
+        if (_token[_children[c]] == token)
+            return _children[c];
+    return -1;
+}
+
+int ParseDataIndex::lastChild(int node, Token token) const
+{
+    for (int c = _child_offset[node + 1] - 1; c >= _child_offset[node]; --c)
+        if (_token[_children[c]] == token)
+            return _children[c];
+    return -1;
+}
+
+int ParseDataIndex::operatorToken(int node) const
+{
+    return node < 0 ? -1 : firstChild(node, Token::Operator);
+}
+
+void ParseDataIndex::argumentNodes(int node, SEXP call, std::vector<int>& out) const
+{
+    static const SEXP s_function = Rf_install("function");
+    static const SEXP s_for = Rf_install("for");
+
+    const std::size_t base = out.size();
+    const int n_args = Rf_length(CDR(call));
+    out.resize(base + n_args, -1);
+    if (node < 0)
+        return;
+
+    const int *begin = _children.data() + _child_offset[node];
+    const int *end   = _children.data() + _child_offset[node + 1];
+
+    // argument expressions in source order
+    std::vector<int>& exprs = _exprs;
+    const std::size_t exprs_capacity = exprs.capacity();
+    exprs.clear();
+    bool right_assign = false, pipe = false, call_syntax = false;
+    for (const int *c = begin; c != end; ++c) {
+        switch (_token[*c]) {
+        case Token::Expr:        exprs.push_back(*c); break;
+        case Token::RightAssign: right_assign = true; break;
+        case Token::Pipe:        pipe = true; break;
+        case Token::LeftParen:   call_syntax = call_syntax || (c == begin + 1 && _token[*begin] == Token::Expr); break;
+        default: break;
+        }
+    }
+    AllocStats::buffer(exprs, exprs_capacity);
+
+    // the pipe rewrites the call, its arguments cannot be matched by position
+    if (pipe)
+        return;
+
+    SEXP fun = CAR(call);
+    if (fun == s_function) {
+        // formals are a pairlist and the srcref is not parsed code; the body
+        // is the last expression
+        if (n_args >= 2 && !exprs.empty())
+            out[base + 1] = exprs.back();
+        return;
+    }
+    if (fun == s_for) {
+        int cond = firstChild(node, Token::ForCond);
+        if (n_args == 3) {
+            out[base + 1] = cond < 0 ? -1 : lastChild(cond, Token::Expr);
+            out[base + 2] = exprs.empty() ? -1 : exprs.back();
+        }
+        return;
+    }
+
+    // f(x): the first expression is the function itself
+    size_t next = call_syntax ? 1 : 0;
+    if (right_assign)
+        std::reverse(exprs.begin(), exprs.end());
+
+    int k = 0;
+    for (SEXP arg = CDR(call); arg != R_NilValue && next < exprs.size(); arg = CDR(arg), ++k) {
+        if (CAR(arg) == R_MissingArg)
+            continue;                   // x[, 1] has no node for the empty argument
+        out[base + k] = exprs[next++];
+    }
+}
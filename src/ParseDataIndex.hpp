@@ -0,0 +1,74 @@
+// ParseDataIndex.h
+#ifndef PARSE_DATA_INDEX_H
+#define PARSE_DATA_INDEX_H
+
+#include <cpp11.hpp>
+#include <R.h>
+#include <Rinternals.h>
+
+// Undefine the 'length' macro defined by Rinternals.h to avoid conflicts with the C++ standard library
+#undef length
+
+#include <cstdint>
+#include <map>
+#include <utility>
+#include <vector>
+
+// Source range of a token or expression, 1-based lines and columns
+struct SourceSpan {
+    int line1;
+    int col1;
+    int line2;
+    int col2;
+};
+
+// Index over R's parse data (the token table kept in srcfile$parseData when
+// a file is parsed with keep.source = TRUE). It is built once per file and
+// maps AST nodes to the exact token ranges they were parsed from.
+class ParseDataIndex {
+public:
+    // Reads the parse data of a parsed file; the index is empty if there is none
+    explicit ParseDataIndex(SEXP exprs);
+    ~ParseDataIndex() = default;
+
+    bool empty() const { return _line1.empty(); }
+
+    // Parse node of the top-level expression with this srcref, -1 if unknown
+    int topLevelNode(SEXP src_ref) const;
+
+    // Appends the parse nodes of the arguments of `call` to `out`, aligned
+    // with CDR(call); -1 where the argument has no parse node of its own
+    void argumentNodes(int node, SEXP call, std::vector<int>& out) const;
+
+    // Operator token directly below `node`, -1 if there is none
+    int operatorToken(int node) const;
+
+    SourceSpan span(int row) const {
+        return {_line1[row], _col1[row], _line2[row], _col2[row]};
+    }
+
+private:
+    enum class Token : std::uint8_t {
+        Expr, Operator, LeftParen, RightAssign, Pipe, ForCond, Other
+    };
+
+    std::vector<int> _line1, _col1, _line2, _col2;
+    std::vector<Token> _token;
+
+    // children of every row sorted by position, in CSR layout
+    std::vector<int> _child_offset;
+    std::vector<int> _children;
+
+    // (line1, col1) of top-level expressions -> row
+    std::map<std::pair<int, int>, int> _top_level;
+
+    // scratch for argumentNodes, reused across calls
+    mutable std::vector<int> _exprs;
+
+    static Token classify(const char *token);
+
+    int firstChild(int node, Token token) const;
+    int lastChild(int node, Token token) const;
+};
+
+#endif // PARSE_DATA_INDEX_H
@@ -1 +0,0 @@
-#include "PlusOperator.hpp"
\ No newline at end of file
@@ -0,0 +1,1020 @@
+// RScanner.cpp
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <unordered_set>
+#include "RScanner.hpp"
+#include "AllocStats.hpp"
+
+namespace {
+
+enum class Tok : std::uint8_t {
+    Number, String, Symbol, Op, LParen, RParen, LBrace, RBrace, LBracket, LBB, RBracket,
+    Comma, Semicolon, Newline, If, Else, For, In, While, Repeat, Function, Break, Next,
+    True, False, Inf, Constant, End
+};
+
+struct Token {
+    Tok type;
+    int begin, end;                 // bytes [begin, end) of the file
+    int line1, col1, byte1;         // R's numbering of the first character
+    int line2, col2, byte2;         // and of the last one
+    std::string text;               // operator, symbol name or number text
+};
+
+struct ScanError : std::runtime_error {
+    explicit ScanError(const std::string& what) : std::runtime_error(what) {}
+};
+
+std::string where(int line)
+{
+    return " at line " + std::to_string(line);
+}
+
+// Splits R source into tokens the way R's lexer does: newlines are only
+// tokens at the top level and directly inside braces, "**" is "^", and
+// columns count characters with tabs advancing to the next multiple of 8.
+class Lexer {
+public:
+    explicit Lexer(const std::string& src) : _src(src) {}
+
+    std::vector<Token> run()
+    {
+        std::vector<Token> out;
+        for (;;) {
+            skipSpace();
+            if (_pos >= _src.size())
+                break;
+            out.push_back(next());
+        }
+        Token end = {Tok::End, static_cast<int>(_src.size()), static_cast<int>(_src.size()),
+                     _line, _col, _byte, _line, _col, _byte, std::string()};
+        out.push_back(end);
+        return out;
+    }
+
+private:
+    const std::string& _src;
+    std::size_t _pos = 0;
+    int _line = 1, _col = 0, _byte = 0;
+    std::vector<char> _context;     // open ( [ and { brackets
+
+    int peekc(std::size_t k = 0) const
+    {
+        return _pos + k < _src.size() ? static_cast<unsigned char>(_src[_pos + k]) : -1;
+    }
+
+    void advance()
+    {
+        const unsigned char c = static_cast<unsigned char>(_src[_pos++]);
+        if (c == '\n') {
+            ++_line;
+            _col = 0;
+            _byte = 0;
+            return;
+        }
+        // continuation bytes of a UTF-8 character keep the column
+        if (c >= 0x80 && c <= 0xBF)
+            --_col;
+        ++_col;
+        ++_byte;
+        if (c == '\t')
+            _col = (_col + 7) & ~7;
+    }
+
+    void skipSpace()
+    {
+        for (;;) {
+            const int c = peekc();
+            if (c == ' ' || c == '\t' || c == '\f' || c == '\r' || c == '\v') {
+                advance();
+            } else if (c == '#') {
+                while (peekc() != -1 && peekc() != '\n')
+                    advance();
+            } else if (c == '\n' && !newlinesCount()) {
+                advance();
+            } else {
+                return;
+            }
+        }
+    }
+
+    bool newlinesCount() const { return _context.empty() || _context.back() == '{'; }
+
+    static bool isIdentStart(int c)
+    {
+        return c >= 0x80 || std::isalpha(c) || c == '.' || c == '_';
+    }
+
+    static bool isIdentChar(int c)
+    {
+        return c >= 0x80 || std::isalnum(c) || c == '.' || c == '_';
+    }
+
+    Token next()
+    {
+        Token t;
+        t.begin = static_cast<int>(_pos);
+        const int c = peekc();
+        consume(t);
+
+        if (c == '\n') {
+            t.type = Tok::Newline;
+        } else if (std::isdigit(c) || (c == '.' && peekc() != -1 && std::isdigit(peekc()))) {
+            number(t, c);
+        } else if ((c == 'r' || c == 'R') && (peekc() == '"' || peekc() == '\'') &&
+                   rawString(t)) {
+            t.type = Tok::String;
+        } else if (isIdentStart(c)) {
+            while (isIdentChar(peekc()))
+                more(t);
+            t.text = _src.substr(t.begin, _pos - t.begin);
+            keyword(t);
+        } else if (c == '"' || c == '\'') {
+            quoted(t, c);
+            t.type = Tok::String;
+            t.text = _src.substr(t.begin + 1, _pos - t.begin - 2);
+        } else if (c == '`') {
+            quoted(t, c);
+            t.type = Tok::Symbol;
+            t.text = _src.substr(t.begin + 1, _pos - t.begin - 2);
+        } else {
+            punctuation(t, c);
+        }
+        t.end = static_cast<int>(_pos);
+        return t;
+    }
+
+    // Take the first character of a token
+    void consume(Token& t)
+    {
+        advance();
+        t.line1 = t.line2 = _line;
+        t.col1 = t.col2 = _col;
+        t.byte1 = t.byte2 = _byte;
+    }
+
+    // Take one more character of a token
+    void more(Token& t)
+    {
+        advance();
+        t.line2 = _line;
+        t.col2 = _col;
+        t.byte2 = _byte;
+    }
+
+    void number(Token& t, int first)
+    {
+        if (first == '0' && (peekc() == 'x' || peekc() == 'X')) {
+            more(t);
+            while (std::isxdigit(peekc()) || peekc() == '.')
+                more(t);
+            if (peekc() == 'p' || peekc() == 'P') {
+                more(t);
+                if (peekc() == '+' || peekc() == '-') more(t);
+                while (peekc() != -1 && std::isdigit(peekc())) more(t);
+            }
+        } else {
+            while (peekc() != -1 && (std::isdigit(peekc()) || peekc() == '.'))
+                more(t);
+            if ((peekc() == 'e' || peekc() == 'E') &&
+                (std::isdigit(peekc(1)) ||
+                 ((peekc(1) == '+' || peekc(1) == '-') && std::isdigit(peekc(2))))) {
+                more(t);
+                if (peekc() == '+' || peekc() == '-') more(t);
+                while (peekc() != -1 && std::isdigit(peekc())) more(t);
+            }
+        }
+        t.text = _src.substr(t.begin, _pos - t.begin);
+        t.type = Tok::Number;
+        if (peekc() == 'L' || peekc() == 'i') {
+            more(t);
+            t.text += _src[_pos - 1];
+        }
+    }
+
+    void quoted(Token& t, int quote)
+    {
+        for (;;) {
+            const int c = peekc();
+            if (c == -1)
+                throw ScanError("unterminated string" + where(t.line1));
+            more(t);
+            if (c == '\\') {
+                if (peekc() == -1)
+                    throw ScanError("unterminated string" + where(t.line1));
+                more(t);
+            } else if (c == quote) {
+                return;
+            }
+        }
+    }
+
+    // r"(...)", R'[...]', r"---{...}---" and so on; false when the r starts
+    // an identifier instead
+    bool rawString(Token& t)
+    {
+        std::size_t k = 1;
+        int dashes = 0;
+        while (peekc(k) == '-') { ++k; ++dashes; }
+        const int open = peekc(k);
+        const int close = open == '(' ? ')' : open == '[' ? ']' : open == '{' ? '}' : 0;
+        if (!close)
+            return false;
+
+        const int quote = peekc();
+        for (std::size_t i = 0; i <= k; ++i)
+            more(t);
+        for (;;) {
+            if (peekc() == -1)
+                throw ScanError("unterminated raw string" + where(t.line1));
+            if (peekc() == close) {
+                int d = 0;
+                while (d < dashes && peekc(1 + d) == '-') ++d;
+                if (d == dashes && peekc(1 + dashes) == quote) {
+                    for (int i = 0; i < dashes + 2; ++i)
+                        more(t);
+                    return true;
+                }
+            }
+            more(t);
+        }
+    }
+
+    void keyword(Token& t)
+    {
+        static const std::pair<const char *, Tok> keywords[] = {
+            {"if", Tok::If}, {"else", Tok::Else}, {"for", Tok::For}, {"in", Tok::In},
+            {"while", Tok::While}, {"repeat", Tok::Repeat}, {"function", Tok::Function},
+            {"break", Tok::Break}, {"next", Tok::Next}, {"TRUE", Tok::True},
+            {"FALSE", Tok::False}, {"Inf", Tok::Inf}, {"NULL", Tok::Constant},
+            {"NA", Tok::Constant}, {"NaN", Tok::Constant}, {"NA_integer_", Tok::Constant},
+            {"NA_real_", Tok::Constant}, {"NA_character_", Tok::Constant},
+            {"NA_complex_", Tok::Constant}
+        };
+        t.type = Tok::Symbol;
+        for (const auto& k : keywords)
+            if (t.text == k.first)
+                t.type = k.second;
+    }
+
+    void punctuation(Token& t, int c)
+    {
+        auto take = [&](const char *rest) {
+            std::size_t k = 0;
+            for (; rest[k]; ++k) {
+                if (peekc(k) != static_cast<unsigned char>(rest[k]))
+                    return false;
+            }
+            while (k--)
+                more(t);
+            return true;
+        };
+
+        t.type = Tok::Op;
+        switch (c) {
+        case '(': t.type = Tok::LParen; _context.push_back('('); return;
+        case '{': t.type = Tok::LBrace; _context.push_back('{'); return;
+        case '[':
+            if (take("[")) {
+                t.type = Tok::LBB;
+                _context.push_back('[');
+                _context.push_back('[');
+            } else {
+                t.type = Tok::LBracket;
+                _context.push_back('[');
+            }
+            return;
+        case ')': t.type = Tok::RParen;   pop(); return;
+        case '}': t.type = Tok::RBrace;   pop(); return;
+        case ']': t.type = Tok::RBracket; pop(); return;
+        case ',': t.type = Tok::Comma; return;
+        case ';': t.type = Tok::Semicolon; return;
+        case '\\': t.type = Tok::Function; t.text = "function"; return;
+        case '<':
+            t.text = take("<-") ? "<<-" : take("=") ? "<=" : take("-") ? "<-" : "<";
+            return;
+        case '-': t.text = take(">>") ? "->>" : take(">") ? "->" : "-"; return;
+        case '>': t.text = take("=") ? ">=" : ">"; return;
+        case '=': t.text = take("=") ? "==" : "="; return;
+        case '!': t.text = take("=") ? "!=" : "!"; return;
+        case '&': t.text = take("&") ? "&&" : "&"; return;
+        case '|': t.text = take("|") ? "||" : take(">") ? "|>" : "|"; return;
+        case ':': t.text = take("::") ? ":::" : take(":") ? "::" : take("=") ? ":=" : ":"; return;
+        case '*': t.text = take("*") ? "^" : "*"; return;
+        case '+': case '/': case '^': case '~': case '?': case '$': case '@':
+            t.text = std::string(1, static_cast<char>(c));
+            return;
+        case '%':
+            while (peekc() != '%') {
+                if (peekc() == -1 || peekc() == '\n')
+                    throw ScanError("unterminated %operator%" + where(t.line1));
+                more(t);
+            }
+            more(t);
+            t.text = _src.substr(t.begin, _pos - t.begin);
+            return;
+        default:
+            throw ScanError("unexpected input" + where(t.line1));
+        }
+    }
+
+    void pop()
+    {
+        if (!_context.empty())
+            _context.pop_back();
+    }
+};
+
+// A node of the parsed tree, shaped like the R object parse() returns
+struct Node {
+    enum class Kind : std::uint8_t { Call, Symbol, Constant, String, Missing, Other };
+
+    Kind kind;
+    int first, last;              // token range
+    int op_token;                 // operator token of a call, -1 in call syntax
+    const std::string *name;      // head symbol of a call or name of a symbol
+    SEXPTYPE type;                // LGLSXP, INTSXP or REALSXP for constants
+    double value;
+    bool pipe;                    // call rewritten by |>; its arguments have no parse node
+    std::vector<int> args;        // arguments in the order of CDR(call)
+};
+
+// Pratt parser over the tokens. Binding powers follow ?Syntax; postfix
+// calls and indexing bind tightest.
+class Parser {
+public:
+    explicit Parser(const std::vector<Token>& toks) : _toks(toks) {}
+
+    std::vector<Node> nodes;
+    std::vector<int> top_level;   // node of every top-level expression
+
+    void run()
+    {
+        for (;;) {
+            skip({Tok::Newline, Tok::Semicolon});
+            if (peek().type == Tok::End)
+                break;
+            top_level.push_back(expr(0));
+            const Tok t = peek().type;
+            if (t != Tok::Newline && t != Tok::Semicolon && t != Tok::End)
+                unexpected();
+        }
+    }
+
+private:
+    const std::vector<Token>& _toks;
+    std::size_t _pos = 0;
+    int _brace_depth = 0;
+    std::unordered_set<std::string> _names;
+
+    enum { BP_HELP = 1, BP_EQ_ASSIGN = 2, BP_LEFT_ASSIGN = 3, BP_RIGHT_ASSIGN = 4,
+           BP_TILDE = 5, BP_OR = 6, BP_AND = 7, BP_NOT = 8, BP_COMPARE = 9, BP_SUM = 10,
+           BP_PRODUCT = 11, BP_SPECIAL = 12, BP_RANGE = 13, BP_UNARY = 14, BP_POWER = 15,
+           BP_DOLLAR = 16, BP_NAMESPACE = 17, BP_POSTFIX = 18 };
+
+    const Token& peek(std::size_t k = 0) const
+    {
+        return _toks[std::min(_pos + k, _toks.size() - 1)];
+    }
+
+    int take()
+    {
+        const int i = static_cast<int>(_pos);
+        if (_pos + 1 < _toks.size())
+            ++_pos;
+        return i;
+    }
+
+    void skip(std::initializer_list<Tok> types)
+    {
+        while (std::find(types.begin(), types.end(), peek().type) != types.end())
+            take();
+    }
+
+    void skipNewlines() { skip({Tok::Newline}); }
+
+    [[noreturn]] void unexpected() const
+    {
+        const Token& t = peek();
+        throw ScanError(std::string(t.type == Tok::End ? "unexpected end of input"
+                                                       : "unexpected '" + tokenText(t) + "'") +
+                        where(t.line1));
+    }
+
+    static std::string tokenText(const Token& t)
+    {
+        switch (t.type) {
+        case Tok::Newline:   return "\\n";
+        case Tok::LParen:    return "(";
+        case Tok::RParen:    return ")";
+        case Tok::LBrace:    return "{";
+        case Tok::RBrace:    return "}";
+        case Tok::LBracket:  return "[";
+        case Tok::LBB:       return "[[";
+        case Tok::RBracket:  return "]";
+        case Tok::Comma:     return ",";
+        case Tok::Semicolon: return ";";
+        default:             return t.text;
+        }
+    }
+
+    int expect(Tok type)
+    {
+        if (peek().type != type)
+            unexpected();
+        return take();
+    }
+
+    const std::string *intern(const std::string& name)
+    {
+        return &*_names.insert(name).first;
+    }
+
+    int add(Node::Kind kind, int first, int last)
+    {
+        Node n = {kind, first, last, -1, nullptr, NILSXP, 0, false, {}};
+        nodes.push_back(n);
+        return static_cast<int>(nodes.size()) - 1;
+    }
+
+    int call(const char *head, int first, int last, std::vector<int> args, int op_token = -1)
+    {
+        const int id = add(Node::Kind::Call, first, last);
+        nodes[id].name = intern(head);
+        nodes[id].op_token = op_token;
+        nodes[id].args = std::move(args);
+        return id;
+    }
+
+    // Left binding power of an infix or postfix token, 0 if it is none
+    static int infixPower(const Token& t, bool *right)
+    {
+        *right = false;
+        switch (t.type) {
+        case Tok::LParen: case Tok::LBracket: case Tok::LBB:
+            return BP_POSTFIX;
+        case Tok::Op:
+            break;
+        default:
+            return 0;
+        }
+
+        const std::string& op = t.text;
+        if (op == "?")                                   return BP_HELP;
+        if (op == "=")  { *right = true;                 return BP_EQ_ASSIGN; }
+        if (op == "<-" || op == "<<-" || op == ":=") { *right = true; return BP_LEFT_ASSIGN; }
+        if (op == "->" || op == "->>")                   return BP_RIGHT_ASSIGN;
+        if (op == "~")                                   return BP_TILDE;
+        if (op == "|" || op == "||")                     return BP_OR;
+        if (op == "&" || op == "&&")                     return BP_AND;
+        if (op == "==" || op == "!=" || op == "<" || op == ">" || op == "<=" || op == ">=")
+            return BP_COMPARE;
+        if (op == "+" || op == "-")                      return BP_SUM;
+        if (op == "*" || op == "/")                      return BP_PRODUCT;
+        if (op == "|>" || op[0] == '%')                  return BP_SPECIAL;
+        if (op == ":")                                   return BP_RANGE;
+        if (op == "^")  { *right = true;                 return BP_POWER; }
+        if (op == "$" || op == "@")                      return BP_DOLLAR;
+        if (op == "::" || op == ":::")                   return BP_NAMESPACE;
+        return 0;
+    }
+
+    int expr(int min_bp)
+    {
+        int lhs = prefix();
+        for (;;) {
+            bool right;
+            const int bp = infixPower(peek(), &right);
+            if (bp <= min_bp)
+                return lhs;
+
+            if (bp == BP_POSTFIX) {
+                lhs = postfix(lhs);
+                continue;
+            }
+
+            const int op = take();
+            const std::string& text = _toks[op].text;
+            if (bp == BP_DOLLAR || bp == BP_NAMESPACE) {
+                const int rhs = member();
+                lhs = call(text.c_str(), nodes[lhs].first, nodes[rhs].last, {lhs, rhs}, op);
+                continue;
+            }
+
+            skipNewlines();
+            const int rhs = expr(right ? bp - 1 : bp);
+            if (text == "|>") {
+                lhs = pipe(lhs, rhs);
+            } else if (text == "->" || text == "->>") {
+                // a -> b is parsed as b <- a
+                lhs = call(text == "->" ? "<-" : "<<-", nodes[lhs].first, nodes[rhs].last,
+                           {rhs, lhs}, op);
+            } else {
+                lhs = call(text.c_str(), nodes[lhs].first, nodes[rhs].last, {lhs, rhs}, op);
+            }
+        }
+    }
+
+    // Right-hand side of $, @, :: and :::
+    int member()
+    {
+        const Token& t = peek();
+        if (t.type == Tok::Symbol) {
+            const int i = take();
+            const int id = add(Node::Kind::Symbol, i, i);
+            nodes[id].name = intern(_toks[i].text);
+            return id;
+        }
+        if (t.type == Tok::String) {
+            const int i = take();
+            return add(Node::Kind::String, i, i);
+        }
+        if (t.type == Tok::LParen)
+            return primary();
+        unexpected();
+    }
+
+    // lhs |> f(y) is f(lhs, y), or f(y, x = lhs) for f(y, x = _)
+    int pipe(int lhs, int rhs)
+    {
+        Node& target = nodes[rhs];
+        if (target.kind != Node::Kind::Call || target.op_token >= 0)
+            throw ScanError("the pipe needs a function call on its right" +
+                            where(_toks[nodes[rhs].first].line1));
+        bool placed = false;
+        for (int& arg : target.args) {
+            if (nodes[arg].kind == Node::Kind::Symbol && *nodes[arg].name == "_") {
+                arg = lhs;
+                placed = true;
+                break;
+            }
+        }
+        if (!placed)
+            target.args.insert(target.args.begin(), lhs);
+        target.first = nodes[lhs].first;
+        target.pipe = true;
+        return rhs;
+    }
+
+    int postfix(int lhs)
+    {
+        const Tok type = peek().type;
+        take();
+        const Tok closer = type == Tok::LParen ? Tok::RParen : Tok::RBracket;
+        std::vector<int> args = arguments(closer, type != Tok::LParen);
+        int last = expect(closer);
+        if (type == Tok::LBB)
+            last = expect(Tok::RBracket);
+
+        if (type != Tok::LParen) {
+            args.insert(args.begin(), lhs);
+            return call(type == Tok::LBB ? "[[" : "[", nodes[lhs].first, last, std::move(args));
+        }
+
+        // f(x): the head is a symbol for names and strings, otherwise a call
+        // the gatherer does not descend into
+        const Node head = nodes[lhs];
+        const int id = add(Node::Kind::Call, head.first, last);
+        if (head.kind == Node::Kind::Symbol)
+            nodes[id].name = head.name;
+        else if (head.kind == Node::Kind::String)
+            nodes[id].name = intern(_toks[head.first].text);
+        nodes[id].args = std::move(args);
+        return id;
+    }
+
+    // Arguments up to `closer`, which is left to the caller. Empty arguments
+    // are missing; `[` keeps a lone empty argument, a call drops it.
+    std::vector<int> arguments(Tok closer, bool subscript)
+    {
+        std::vector<int> args;
+        if (peek().type == closer) {
+            if (subscript)
+                args.push_back(missing());
+            return args;
+        }
+        for (;;) {
+            const Tok t = peek().type;
+            if ((t == Tok::Symbol || t == Tok::String || t == Tok::Constant) &&
+                peek(1).type == Tok::Op && peek(1).text == "=") {
+                take();
+                take();
+            }
+            const Tok now = peek().type;
+            args.push_back(now == Tok::Comma || now == closer ? missing() : expr(BP_EQ_ASSIGN));
+            if (peek().type != Tok::Comma)
+                return args;
+            take();
+        }
+    }
+
+    int missing()
+    {
+        const int i = static_cast<int>(_pos);
+        return add(Node::Kind::Missing, i, i);
+    }
+
+    int prefix()
+    {
+        const Token& t = peek();
+        if (t.type == Tok::Op && (t.text == "-" || t.text == "+" || t.text == "!" ||
+                                  t.text == "~" || t.text == "?")) {
+            const int op = take();
+            const int bp = t.text == "!" ? BP_NOT : t.text == "~" ? BP_TILDE :
+                           t.text == "?" ? BP_HELP : BP_UNARY;
+            skipNewlines();
+            const int operand = expr(bp);
+            return call(_toks[op].text.c_str(), op, nodes[operand].last, {operand}, op);
+        }
+        return primary();
+    }
+
+    int primary()
+    {
+        const Token& t = peek();
+        const int first = static_cast<int>(_pos);
+        switch (t.type) {
+        case Tok::Number:
+            take();
+            return number(first);
+        case Tok::String:
+            take();
+            return add(Node::Kind::String, first, first);
+        case Tok::Symbol: {
+            take();
+            const int id = add(Node::Kind::Symbol, first, first);
+            nodes[id].name = intern(t.text);
+            return id;
+        }
+        case Tok::True:
+        case Tok::False:
+        case Tok::Inf: {
+            take();
+            const int id = add(Node::Kind::Constant, first, first);
+            nodes[id].type = t.type == Tok::Inf ? REALSXP : LGLSXP;
+            nodes[id].value = t.type == Tok::True ? 1 : t.type == Tok::False ? 0 : HUGE_VAL;
+            return id;
+        }
+        case Tok::Constant:
+            take();
+            return add(Node::Kind::Other, first, first);
+        case Tok::LParen: {
+            take();
+            const int inner = expr(0);
+            return call("(", first, expect(Tok::RParen), {inner});
+        }
+        case Tok::LBrace:
+            return block();
+        case Tok::If:
+            return ifElse();
+        case Tok::For: {
+            take();
+            expect(Tok::LParen);
+            const int var = member();
+            expect(Tok::In);
+            const int seq = expr(0);
+            expect(Tok::RParen);
+            skipNewlines();
+            const int body = expr(0);
+            return call("for", first, nodes[body].last, {var, seq, body});
+        }
+        case Tok::While: {
+            take();
+            expect(Tok::LParen);
+            const int cond = expr(0);
+            expect(Tok::RParen);
+            skipNewlines();
+            const int body = expr(0);
+            return call("while", first, nodes[body].last, {cond, body});
+        }
+        case Tok::Repeat: {
+            take();
+            skipNewlines();
+            const int body = expr(0);
+            return call("repeat", first, nodes[body].last, {body});
+        }
+        case Tok::Break:
+        case Tok::Next:
+            take();
+            return call(t.type == Tok::Break ? "break" : "next", first, first, {});
+        case Tok::Function:
+            return function();
+        default:
+            unexpected();
+        }
+    }
+
+    int number(int i)
+    {
+        std::string text = _toks[i].text;
+        const char suffix = text.back();
+        if (suffix == 'i')
+            return add(Node::Kind::Other, i, i);
+        if (suffix == 'L')
+            text.pop_back();
+
+        const int id = add(Node::Kind::Constant, i, i);
+        const double v = std::strtod(text.c_str(), nullptr);
+        nodes[id].value = v;
+        // 1.5L stays a double, as R warns
+        nodes[id].type = suffix == 'L' && v == std::floor(v) && std::fabs(v) <= INT_MAX
+                             ? INTSXP : REALSXP;
+        return id;
+    }
+
+    int block()
+    {
+        const int first = take();
+        ++_brace_depth;
+        std::vector<int> statements;
+        for (;;) {
+            skip({Tok::Newline, Tok::Semicolon});
+            if (peek().type == Tok::RBrace)
+                break;
+            statements.push_back(expr(0));
+            const Tok t = peek().type;
+            if (t != Tok::Newline && t != Tok::Semicolon && t != Tok::RBrace)
+                unexpected();
+        }
+        --_brace_depth;
+        return call("{", first, take(), std::move(statements));
+    }
+
+    int ifElse()
+    {
+        const int first = take();
+        expect(Tok::LParen);
+        const int cond = expr(0);
+        expect(Tok::RParen);
+        skipNewlines();
+        const int then = expr(0);
+
+        // inside braces the else may start the next line
+        std::size_t k = 0;
+        if (_brace_depth > 0)
+            while (peek(k).type == Tok::Newline) ++k;
+        if (peek(k).type != Tok::Else)
+            return call("if", first, nodes[then].last, {cond, then});
+        _pos += k;
+        take();
+        skipNewlines();
+        const int otherwise = expr(0);
+        return call("if", first, nodes[otherwise].last, {cond, then, otherwise});
+    }
+
+    int function()
+    {
+        const int first = take();
+        const int open = expect(Tok::LParen);
+        // formals are a pairlist: their defaults are parsed but never visited
+        while (peek().type != Tok::RParen) {
+            expect(Tok::Symbol);
+            if (peek().type == Tok::Op && peek().text == "=") {
+                take();
+                expr(BP_EQ_ASSIGN);
+            }
+            if (peek().type != Tok::Comma)
+                break;
+            take();
+        }
+        const int close = expect(Tok::RParen);
+        skipNewlines();
+        const int body = expr(0);
+        const int formals = add(Node::Kind::Other, open, close);
+        const int srcref = add(Node::Kind::Other, first, nodes[body].last);
+        return call("function", first, nodes[body].last, {formals, body, srcref});
+    }
+};
+
+// Walks the tree like ASTHandler::gatherOperatorsRecursive walks R's parse
+class SiteGatherer {
+public:
+    SiteGatherer(const std::vector<Token>& toks, const std::vector<Node>& nodes, ScannedFile& out)
+        : _toks(toks), _nodes(nodes), _out(out), _parent(nodes.size(), -1) {}
+
+    void gather(int expr_index, int root, bool in_block)
+    {
+        _expr_index = expr_index;
+        _in_block = in_block;
+        _root = root;
+        _node_index = 0;
+        _path.clear();
+        _site_nodes.clear();
+        _first_site = static_cast<int>(_out.sites.size());
+        visit(root, -1, true);
+        applyRules();
+    }
+
+private:
+    const std::vector<Token>& _toks;
+    const std::vector<Node>& _nodes;
+    ScannedFile& _out;
+
+    int _expr_index = 0;
+    bool _in_block = false;
+    int _root = -1;
+    int _node_index = 0;
+    int _first_site = 0;
+    std::vector<int> _path;
+    std::vector<int> _site_nodes;   // node of every site of the expression
+    std::vector<int> _parent;       // call every visited call is an argument of
+
+    void addSite(OpKind kind, int node, int first, int last)
+    {
+        ScannedSite s;
+        s.kind = kind;
+        s.expr_index = _expr_index;
+        s.op_index = static_cast<int>(_out.sites.size()) - _first_site;
+        s.in_block = _in_block;
+        s.path_offset = static_cast<int>(_out.paths.size());
+        s.path_length = static_cast<int>(_path.size());
+        s.node_index = _node_index - 1;
+        s.ruling = {SiteVerdict::Keep, nullptr};
+        _out.paths.insert(_out.paths.end(), _path.begin(), _path.end());
+
+        if (first < 0) {
+            // no parse node: R falls back to the srcref of the expression,
+            // whose columns are bytes
+            const Token& ra = _toks[_nodes[_root].first];
+            const Token& rb = _toks[_nodes[_root].last];
+            s.line1 = ra.line1; s.col1 = ra.byte1;
+            s.line2 = rb.line2; s.col2 = rb.byte2;
+            s.byte1 = ra.begin; s.byte2 = rb.end;
+        } else {
+            const Token& a = _toks[first];
+            const Token& b = _toks[last];
+            s.line1 = a.line1; s.col1 = a.col1;
+            s.line2 = b.line2; s.col2 = b.col2;
+            s.byte1 = a.begin; s.byte2 = b.end;
+        }
+        _out.sites.push_back(s);
+        _site_nodes.push_back(node);
+    }
+
+    void visit(int id, int parent, bool exact)
+    {
+        const Node& n = _nodes[id];
+        if (n.kind != Node::Kind::Call)
+            return;
+        ++_node_index;
+        _parent[id] = parent;
+
+        OpKind kind;
+        if (n.name && flipKind(*n.name, &kind)) {
+            // a flip only rewrites the operator token
+            if (exact && n.op_token >= 0)
+                addSite(kind, id, n.op_token, n.op_token);
+            else
+                addSite(kind, id, -1, -1);
+        }
+
+        const bool brace = n.name && (*n.name == "{" || *n.name == "}");
+        if (_in_block && !brace) {
+            if (exact)
+                addSite(OpKind::Delete, id, n.first, n.last);
+            else
+                addSite(OpKind::Delete, id, -1, -1);
+        }
+
+        for (std::size_t k = 0; k < n.args.size(); ++k) {
+            _path.push_back(static_cast<int>(k));
+            visit(n.args[k], id, exact && !n.pipe);
+            _path.pop_back();
+        }
+    }
+
+    static bool flipKind(const std::string& name, OpKind *kind)
+    {
+        for (int i = 0; i < N_FLIP_KINDS; ++i) {
+            if (name == OP_SPECS[i].symbol) {
+                *kind = static_cast<OpKind>(i);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    RuleOperand operand(int id) const
+    {
+        const Node& n = _nodes[id];
+        RuleOperand op = {RuleOperand::Kind::Other, NILSXP, 0, nullptr};
+        if (n.kind == Node::Kind::Symbol) {
+            op.kind = RuleOperand::Kind::Symbol;
+            op.symbol = n.name;
+        } else if (n.kind == Node::Kind::Constant) {
+            op.kind = RuleOperand::Kind::Constant;
+            op.type = n.type;
+            op.value = n.value;
+        }
+        return op;
+    }
+
+    // The rules of SiteRules::check on this tree
+    void applyRules()
+    {
+        const int n = static_cast<int>(_out.sites.size()) - _first_site;
+
+        std::unordered_set<int> deleted;
+        for (int i = 0; i < n; ++i) {
+            const ScannedSite& s = _out.sites[_first_site + i];
+            if (s.kind == OpKind::Delete && s.path_length > 0)
+                deleted.insert(_site_nodes[i]);
+        }
+
+        for (int i = 0; i < n; ++i) {
+            ScannedSite& s = _out.sites[_first_site + i];
+            const Node& node = _nodes[_site_nodes[i]];
+            if (s.kind != OpKind::Delete) {
+                if (node.args.size() == 2)
+                    s.ruling = checkBinaryFlip(s.kind, operand(node.args[0]), operand(node.args[1]));
+                continue;
+            }
+
+            const int block = _parent[_site_nodes[i]];
+            if (block < 0)
+                continue;
+            const Node& b = _nodes[block];
+            if (b.name && *b.name == "{" && b.args.size() == 1 &&
+                deleted.count(_parent[block]))
+                s.ruling = {SiteVerdict::Redundant, "SubsumedDelete"};
+        }
+    }
+};
+
+} // namespace
+
+ScannedFile RScanner::scan(const std::string& text) const
+{
+    ScannedFile out;
+    try {
+        const std::vector<Token> toks = Lexer(text).run();
+        Parser parser(toks);
+        parser.run();
+
+        out.n_exprs = static_cast<int>(parser.top_level.size());
+        SiteGatherer gatherer(toks, parser.nodes, out);
+        // like detect_block_expressions: every expression from the first
+        // top-level block on counts as inside a block
+        bool in_block = false;
+        for (int i = 0; i < out.n_exprs; ++i) {
+            const Node& root = parser.nodes[parser.top_level[i]];
+            in_block = in_block || (root.kind == Node::Kind::Call && root.name && *root.name == "{");
+            gatherer.gather(i, parser.top_level[i], in_block);
+        }
+        AllocStats::buffer(toks);
+        AllocStats::buffer(parser.nodes);
+        AllocStats::buffer(out.sites);
+        AllocStats::buffer(out.paths);
+    } catch (const std::exception& e) {
+        out.error = e.what();
+        out.sites.clear();
+        out.paths.clear();
+    }
+    return out;
+}
+
+ScannedFile RScanner::scanFile(const std::string& path) const
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        ScannedFile out;
+        out.path = path;
+        out.error = "cannot open file";
+        return out;
+    }
+    std::ostringstream text;
+    text << in.rdbuf();
+
+    ScannedFile out = scan(text.str());
+    out.path = path;
+    return out;
+}
+
+std::vector<ScannedFile> RScanner::scanFiles(const std::vector<std::string>& paths,
+                                             int threads) const
+{
+    std::vector<ScannedFile> out(paths.size());
+    std::atomic<std::size_t> next(0);
+    auto work = [&]() {
+        for (std::size_t i = next++; i < paths.size(); i = next++)
+            out[i] = scanFile(paths[i]);
+    };
+
+    const int n = std::max(1, std::min(threads, static_cast<int>(paths.size())));
+    std::vector<std::thread> pool;
+    for (int t = 1; t < n; ++t)
+        pool.emplace_back(work);
+    work();
+    for (std::thread& t : pool)
+        t.join();
+    return out;
+}
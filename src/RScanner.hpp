@@ -0,0 +1,64 @@
+// RScanner.h
+#ifndef R_SCANNER_H
+#define R_SCANNER_H
+
+#include "SiteTable.hpp"
+#include "SiteRules.hpp"
+#include <R.h>
+#include <Rinternals.h>
+
+// Undefine the 'length' macro defined by Rinternals.h to avoid conflicts with the C++ standard library
+#undef length
+
+#include <string>
+#include <vector>
+
+// A mutation site found by the scanner, laid out like a row of
+// C_mutation_sites: the same path, node index, token range and ruling the
+// ASTHandler and SiteRules give for the site over R's own parse.
+struct ScannedSite {
+    OpKind kind;
+    int expr_index;      // 0-based top-level expression
+    int op_index;        // 0-based site within the expression
+    bool in_block;
+    int path_offset;     // path indices in ScannedFile::paths
+    int path_length;
+    int node_index;      // pre-order index of the node
+    int line1, col1, line2, col2;   // parse data range, or the expression's srcref
+    int byte1, byte2;    // byte offsets of that range in the file, end exclusive
+    SiteRuling ruling;
+};
+
+struct ScannedFile {
+    std::string path;
+    std::string error;   // why the file could not be scanned, empty on success
+    int n_exprs = 0;
+    std::vector<ScannedSite> sites;
+    std::vector<int> paths;   // packed path indices of every site
+
+    const int *pathData(int i) const { return paths.data() + sites[i].path_offset; }
+};
+
+// Standalone lexer and parser for R source. It reads as much of the R
+// grammar as finding operators and statements needs (operators and their
+// precedence, calls, indexing, control flow, function definitions, the
+// native pipe) and records exact byte offsets and R's line and column
+// numbering. No R API is called, so files can be scanned on many threads;
+// the sites are numbered like the ones C_mutation_sites gathers after
+// parse(), so a site can be built from R's parse later on by its row.
+class RScanner {
+public:
+    RScanner() = default;
+    ~RScanner() = default;
+
+    // Sites of R source text; a file that does not parse gets an error
+    ScannedFile scan(const std::string& text) const;
+
+    // Read and scan one file
+    ScannedFile scanFile(const std::string& path) const;
+
+    // Scan files on up to `threads` threads, results in the order of `paths`
+    std::vector<ScannedFile> scanFiles(const std::vector<std::string>& paths, int threads) const;
+};
+
+#endif // R_SCANNER_H
@@ -0,0 +1,160 @@
+// SchemataBuilder.cpp
+
+#include "SchemataBuilder.hpp"
+#include "AllocStats.hpp"
+
+static struct SchemataSyms {
+    SEXP s_if          = Rf_install("if");
+    SEXP s_eq          = Rf_install("==");
+    SEXP s_quote       = Rf_install("quote");
+    SEXP s_bquote      = Rf_install("bquote");
+    SEXP s_substitute  = Rf_install("substitute");
+    SEXP s_expression  = Rf_install("expression");
+    SEXP s_tilde       = Rf_install("~");
+    SEXP s_assign      = Rf_install("<-");
+    SEXP s_assign_eq   = Rf_install("=");
+    SEXP s_assign_glob = Rf_install("<<-");
+} SSYM;
+
+static bool isQuoting(SEXP fun)
+{
+    return fun == SSYM.s_quote || fun == SSYM.s_bquote || fun == SSYM.s_substitute ||
+           fun == SSYM.s_expression || fun == SSYM.s_tilde;
+}
+
+static bool isAssignment(SEXP fun)
+{
+    return fun == SSYM.s_assign || fun == SSYM.s_assign_eq || fun == SSYM.s_assign_glob;
+}
+
+// A call with the given head and argument list, carrying the attributes of `like`
+static SEXP callLike(SEXP fun, SEXP args, SEXP like)
+{
+    SEXP call = PROTECT(AllocStats::sexp(Rf_lcons(fun, args)));
+    SHALLOW_DUPLICATE_ATTRIB(call, like);
+    UNPROTECT(1);
+    return call;
+}
+
+// Fresh copy of the spine of `args`, optionally dropping the cell at `drop`
+static SEXP copySpine(SEXP args, int drop)
+{
+    SEXP head = PROTECT(AllocStats::sexp(Rf_cons(R_NilValue, R_NilValue)));
+    SEXP tail = head;
+    int k = 0;
+    for (SEXP a = args; a != R_NilValue; a = CDR(a), ++k) {
+        if (k == drop)
+            continue;
+        SETCDR(tail, AllocStats::sexp(Rf_cons(CAR(a), R_NilValue)));
+        tail = CDR(tail);
+        SET_TAG(tail, TAG(a));
+    }
+    UNPROTECT(1);
+    return CDR(head);
+}
+
+SEXP SchemataBuilder::build(SEXP expr, const SiteTable& sites, int first_id,
+                            std::vector<bool>& embedded)
+{
+    _first_id = first_id;
+    _sites = &sites;
+    _embedded = &embedded;
+    embedded.assign(sites.size(), false);
+
+    const std::size_t flip_capacity = _flip_at.capacity();
+    const std::size_t delete_capacity = _delete_at.capacity();
+    _flip_at.clear();
+    _delete_at.clear();
+    for (int j = 0; j < sites.size(); ++j) {
+        const int node = sites.node_index[j];
+        if (node < 0)
+            continue;
+        std::vector<int> &at = sites.kind[j] == OpKind::Delete ? _delete_at : _flip_at;
+        if (static_cast<int>(at.size()) <= node)
+            at.resize(node + 1, -1);
+        at[node] = j;
+    }
+    AllocStats::buffer(_flip_at, flip_capacity);
+    AllocStats::buffer(_delete_at, delete_capacity);
+
+    _node = 0;
+    return rebuild(expr);
+}
+
+int SchemataBuilder::siteAt(const std::vector<int>& sites_at, int node) const
+{
+    return node < static_cast<int>(sites_at.size()) ? sites_at[node] : -1;
+}
+
+void SchemataBuilder::skip(SEXP expr)
+{
+    if (TYPEOF(expr) != LANGSXP)
+        return;
+    ++_node;
+    for (SEXP a = CDR(expr); a != R_NilValue; a = CDR(a))
+        skip(CAR(a));
+}
+
+SEXP SchemataBuilder::guard(int site, SEXP mutated, SEXP original)
+{
+    SEXP id   = PROTECT(AllocStats::sexp(Rf_ScalarInteger(_first_id + site)));
+    SEXP cond = PROTECT(AllocStats::nodes(Rf_lang3(SSYM.s_eq, _id_symbol, id)));
+    SEXP res  = AllocStats::nodes(Rf_lang4(SSYM.s_if, cond, mutated, original));
+    (*_embedded)[site] = true;
+    UNPROTECT(2);
+    return res;
+}
+
+SEXP SchemataBuilder::rebuild(SEXP expr)
+{
+    if (TYPEOF(expr) != LANGSXP)
+        return expr;
+
+    const int node = _node++;
+    SEXP fun = CAR(expr);
+    if (isQuoting(fun)) {
+        for (SEXP a = CDR(expr); a != R_NilValue; a = CDR(a))
+            skip(CAR(a));
+        return expr;
+    }
+
+    // arguments with their own sites folded in; the deletion of an argument
+    // is recorded here because it is switched on this call
+    const bool assignment = isAssignment(fun);
+    SEXP args = PROTECT(copySpine(CDR(expr), -1));
+    std::vector<int> arg_deletes;
+    int k = 0;
+    for (SEXP a = args; a != R_NilValue; a = CDR(a), ++k) {
+        SEXP child = CAR(a);
+        arg_deletes.push_back(!assignment && TYPEOF(child) == LANGSXP
+                                  ? siteAt(_delete_at, _node) : -1);
+        if (assignment && k == 0)
+            skip(child);                    // the target must stay a plain call
+        else
+            SETCAR(a, rebuild(child));
+    }
+
+    PROTECT_INDEX ipx;
+    SEXP result = callLike(fun, args, expr);
+    PROTECT_WITH_INDEX(result, &ipx);
+
+    const int flip = siteAt(_flip_at, node);
+    if (flip >= 0) {
+        SEXP flipped = PROTECT(callLike(replacementSymbol(_sites->kind[flip]),
+                                        copySpine(args, -1), expr));
+        REPROTECT(result = guard(flip, flipped, result), ipx);
+        UNPROTECT(1);
+    }
+
+    AllocStats::buffer(arg_deletes);
+    for (k = 0; k < static_cast<int>(arg_deletes.size()); ++k) {
+        if (arg_deletes[k] < 0)
+            continue;
+        SEXP without = PROTECT(callLike(fun, copySpine(args, k), expr));
+        REPROTECT(result = guard(arg_deletes[k], without, result), ipx);
+        UNPROTECT(1);
+    }
+
+    UNPROTECT(2);
+    return result;
+}
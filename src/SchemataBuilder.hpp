@@ -0,0 +1,50 @@
+// SchemataBuilder.h
+#ifndef SCHEMATA_BUILDER_H
+#define SCHEMATA_BUILDER_H
+
+#include "SiteTable.hpp"
+#include <R.h>
+#include <Rinternals.h>
+#include <vector>
+
+// Builds a mutant schema: one copy of an expression with every mutation
+// site folded in behind a runtime switch, so a single instrumented program
+// stands for all of its mutants. Site j is active when the id variable
+// equals first_id + j:
+//
+//   a + b          ->  if (.mutant_id == 17L) a - b else a + b
+//   { x; y }       ->  if (.mutant_id == 18L) { y } else { x; y }
+//
+// Deletions are switched at the parent so the active mutant matches the
+// one built by Mutator exactly. Untouched subtrees are shared with the
+// original expression.
+class SchemataBuilder {
+public:
+    explicit SchemataBuilder(SEXP id_symbol) : _id_symbol(id_symbol) {}
+    ~SchemataBuilder() = default;
+
+    // The instrumented copy of `expr`; `embedded[j]` tells whether site j
+    // could be folded in. Sites inside quoted code and assignment targets
+    // are left out since a switch there would change what the code means.
+    SEXP build(SEXP expr, const SiteTable& sites, int first_id, std::vector<bool>& embedded);
+
+private:
+    SEXP _id_symbol;
+    int _first_id;
+    int _node;
+    const SiteTable *_sites;
+    std::vector<bool> *_embedded;
+    // Flip and delete site of every pre-order node, -1 if none
+    std::vector<int> _flip_at;
+    std::vector<int> _delete_at;
+
+    SEXP rebuild(SEXP expr);
+    // Advance the node counter over a subtree that is kept as is
+    void skip(SEXP expr);
+    int siteAt(const std::vector<int>& sites_at, int node) const;
+
+    // if (id == first_id + site) mutated else original
+    SEXP guard(int site, SEXP mutated, SEXP original);
+};
+
+#endif // SCHEMATA_BUILDER_H
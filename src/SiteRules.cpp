@@ -0,0 +1,196 @@
+// SiteRules.cpp
+
+#include <climits>
+#include <cmath>
+#include <unordered_set>
+#include "SiteRules.hpp"
+
+const char *verdictName(SiteVerdict verdict)
+{
+    switch (verdict) {
+    case SiteVerdict::Equivalent: return "equivalent";
+    case SiteVerdict::Redundant:  return "redundant";
+    default:                      return "keep";
+    }
+}
+
+// A plain scalar constant: logical, integer or double, not NA, no attributes
+static bool scalarConstant(SEXP x, double *value)
+{
+    const SEXPTYPE type = TYPEOF(x);
+    if ((type != LGLSXP && type != INTSXP && type != REALSXP) ||
+        XLENGTH(x) != 1 || ATTRIB(x) != R_NilValue)
+        return false;
+
+    if (type == REALSXP) {
+        if (ISNAN(REAL(x)[0])) return false;
+        *value = REAL(x)[0];
+    } else {
+        const int v = type == LGLSXP ? LOGICAL(x)[0] : INTEGER(x)[0];
+        if (v == NA_INTEGER) return false;    // NA_LOGICAL has the same value
+        *value = v;
+    }
+    return true;
+}
+
+static bool isLogicalKind(OpKind kind)
+{
+    return kind == OpKind::And || kind == OpKind::Or ||
+           kind == OpKind::LogicalAnd || kind == OpKind::LogicalOr;
+}
+
+static bool isArithmeticKind(OpKind kind)
+{
+    return kind == OpKind::Plus || kind == OpKind::Minus ||
+           kind == OpKind::Multiply || kind == OpKind::Divide;
+}
+
+// Value and type of `a op b` for scalar constants; false when R would not
+// give a plain finite value (division by zero, integer overflow)
+static bool evaluate(OpKind kind, const RuleOperand& lhs, const RuleOperand& rhs,
+                     double *value, SEXPTYPE *type)
+{
+    const double a = lhs.value, b = rhs.value;
+    const bool real = lhs.type == REALSXP || rhs.type == REALSXP;
+    switch (kind) {
+    case OpKind::Plus:            *value = a + b; break;
+    case OpKind::Minus:           *value = a - b; break;
+    case OpKind::Multiply:        *value = a * b; break;
+    case OpKind::Divide:
+        if (b == 0) return false;
+        *value = a / b;
+        break;
+    case OpKind::Equal:           *value = a == b; break;
+    case OpKind::NotEqual:        *value = a != b; break;
+    case OpKind::LessThan:        *value = a < b;  break;
+    case OpKind::MoreThan:        *value = a > b;  break;
+    case OpKind::LessThanOrEqual: *value = a <= b; break;
+    case OpKind::MoreThanOrEqual: *value = a >= b; break;
+    case OpKind::And:
+    case OpKind::LogicalAnd:      *value = a != 0 && b != 0; break;
+    case OpKind::Or:
+    case OpKind::LogicalOr:       *value = a != 0 || b != 0; break;
+    default:                      return false;
+    }
+
+    if (!isArithmeticKind(kind))
+        *type = LGLSXP;
+    else
+        *type = (real || kind == OpKind::Divide) ? REALSXP : INTSXP;
+    if (*type == INTSXP && std::fabs(*value) > INT_MAX)
+        return false;
+    return std::isfinite(*value);
+}
+
+// Symbols or constants that are the same value and have no side effects
+static bool sameOperand(const RuleOperand& a, const RuleOperand& b)
+{
+    if (a.kind == RuleOperand::Kind::Symbol)
+        return b.kind == RuleOperand::Kind::Symbol && a.symbol == b.symbol;
+    return a.kind == RuleOperand::Kind::Constant && b.kind == RuleOperand::Kind::Constant &&
+           a.type == b.type && a.value == b.value;
+}
+
+static RuleOperand operandOf(SEXP x)
+{
+    RuleOperand op = {RuleOperand::Kind::Other, NILSXP, 0, nullptr};
+    if (TYPEOF(x) == SYMSXP && x != R_MissingArg) {
+        op.kind = RuleOperand::Kind::Symbol;
+        op.symbol = x;
+    } else if (scalarConstant(x, &op.value)) {
+        op.kind = RuleOperand::Kind::Constant;
+        op.type = TYPEOF(x);
+    }
+    return op;
+}
+
+SiteRuling checkBinaryFlip(OpKind kind, const RuleOperand& lhs, const RuleOperand& rhs)
+{
+    const bool const_lhs = lhs.kind == RuleOperand::Kind::Constant;
+    const bool const_rhs = rhs.kind == RuleOperand::Kind::Constant;
+    const double b = rhs.value;
+
+    // x * 1 and x / 1 are x as a double, x + 0 and x - 0 are x
+    if (const_rhs && !const_lhs) {
+        if ((kind == OpKind::Multiply || kind == OpKind::Divide) &&
+            rhs.type == REALSXP && b == 1)
+            return {SiteVerdict::Equivalent, "IdentityOperand"};
+        if ((kind == OpKind::Plus || kind == OpKind::Minus) && b == 0)
+            return {SiteVerdict::Equivalent, "IdentityOperand"};
+    }
+
+    if (const_lhs && const_rhs) {
+        double before, after;
+        SEXPTYPE type_before, type_after;
+        if (evaluate(kind, lhs, rhs, &before, &type_before) &&
+            evaluate(flippedKind(kind), lhs, rhs, &after, &type_after) &&
+            type_before == type_after && before == after)
+            return {SiteVerdict::Equivalent, "ConstantOperands"};
+    }
+
+    if (sameOperand(lhs, rhs)) {
+        // a < a and a > a are both FALSE, a <= a and a >= a both TRUE, and
+        // a & a equals a | a; NA stays NA either way
+        if (isLogicalKind(kind) ||
+            kind == OpKind::LessThan || kind == OpKind::MoreThan ||
+            kind == OpKind::LessThanOrEqual || kind == OpKind::MoreThanOrEqual)
+            return {SiteVerdict::Equivalent, "SameOperands"};
+        if (kind == OpKind::Equal || kind == OpKind::NotEqual)
+            return {SiteVerdict::Redundant, "SelfComparison"};
+    }
+
+    // x & TRUE is x and x | TRUE is TRUE: the flip only swaps an operand for
+    // a constant
+    if (isLogicalKind(kind) &&
+        ((const_lhs && lhs.type == LGLSXP) != (const_rhs && rhs.type == LGLSXP)))
+        return {SiteVerdict::Redundant, "ConstantLogical"};
+
+    return {SiteVerdict::Keep, nullptr};
+}
+
+static SiteRuling checkFlip(OpKind kind, SEXP call)
+{
+    // only binary calls; unary minus and plus are left alone
+    if (TYPEOF(call) != LANGSXP || Rf_length(call) != 3)
+        return {SiteVerdict::Keep, nullptr};
+    return checkBinaryFlip(kind, operandOf(CADR(call)), operandOf(CADDR(call)));
+}
+
+// Node `up` levels above site i, R_NilValue above the root
+static SEXP ancestor(SEXP expr, const SiteTable& sites, int i, int up)
+{
+    const int depth = sites.path_length[i] - up;
+    if (depth < 0)  return R_NilValue;
+    if (depth == 0) return expr;
+    return CAR(sites.spineData(i)[depth - 1]);
+}
+
+std::vector<SiteRuling> SiteRules::check(SEXP expr, const SiteTable& sites) const
+{
+    const int n = sites.size();
+    std::vector<SiteRuling> rulings(n, SiteRuling{SiteVerdict::Keep, nullptr});
+
+    // nodes some mutant deletes; the root itself cannot be deleted
+    std::unordered_set<SEXP> deleted;
+    for (int i = 0; i < n; ++i)
+        if (sites.kind[i] == OpKind::Delete && sites.path_length[i] > 0 && sites.hasSpine(i))
+            deleted.insert(sites.target(expr, i));
+
+    static SEXP s_lbrace = Rf_install("{");
+    for (int i = 0; i < n; ++i) {
+        if (!sites.hasSpine(i))
+            continue;
+
+        if (sites.kind[i] != OpKind::Delete) {
+            rulings[i] = checkFlip(sites.kind[i], sites.target(expr, i));
+            continue;
+        }
+
+        SEXP block = ancestor(expr, sites, i, 1);
+        SEXP outer = ancestor(expr, sites, i, 2);
+        if (TYPEOF(block) == LANGSXP && CAR(block) == s_lbrace &&
+            CDDR(block) == R_NilValue && deleted.count(outer))
+            rulings[i] = {SiteVerdict::Redundant, "SubsumedDelete"};
+    }
+    return rulings;
+}
@@ -0,0 +1,68 @@
+// SiteRules.h
+#ifndef SITE_RULES_H
+#define SITE_RULES_H
+
+#include "SiteTable.hpp"
+#include <R.h>
+#include <Rinternals.h>
+
+// Undefine the 'length' macro defined by Rinternals.h to avoid conflicts with the C++ standard library
+#undef length
+
+#include <cstdint>
+#include <vector>
+
+// What the static rules say about a site
+enum class SiteVerdict : std::uint8_t {
+    Keep,        // nothing known, the mutant has to be run
+    Equivalent,  // the mutant computes the same values as the original
+    Redundant    // the mutant is subsumed by another mutant or is degenerate
+};
+
+struct SiteRuling {
+    SiteVerdict verdict;
+    const char *rule;    // name of the rule that fired, nullptr for Keep
+};
+
+const char *verdictName(SiteVerdict verdict);
+
+// An operand of a flipped binary call as the rules see it. Parsers other
+// than R's can describe their operands this way to share the flip rules.
+struct RuleOperand {
+    enum class Kind : std::uint8_t { Other, Symbol, Constant };
+
+    Kind kind;
+    SEXPTYPE type;        // LGLSXP, INTSXP or REALSXP for a constant
+    double value;         // value of a constant, never NA
+    const void *symbol;   // identity of a symbol, equal for equal names
+};
+
+// Flip rules for the binary call `lhs op rhs` of `kind`
+SiteRuling checkBinaryFlip(OpKind kind, const RuleOperand& lhs, const RuleOperand& rhs);
+
+// Rules over the gathered sites of one expression that look at operand
+// shapes and constants only, before any mutant is built:
+//
+//  IdentityOperand    x * 1 <-> x / 1 and x + 0 <-> x - 0      (equivalent)
+//  ConstantOperands   both operands are constants and the flip
+//                     evaluates to the same value               (equivalent)
+//  SameOperands       a < a, a <= a, a & a, a && a and their
+//                     flips, with a a symbol or constant         (equivalent)
+//  SelfComparison     a == a <-> a != a flips a constant        (redundant)
+//  ConstantLogical    & / && / | / || with one constant
+//                     TRUE/FALSE operand                        (redundant)
+//  SubsumedDelete     deleting the only statement of a block
+//                     whose enclosing call is deleted as well   (redundant)
+//
+// The rules assume base semantics of the operators; classes that define
+// their own Ops methods can in principle tell the mutants apart.
+class SiteRules {
+public:
+    SiteRules() = default;
+    ~SiteRules() = default;
+
+    // One ruling per site; the sites must carry their spine
+    std::vector<SiteRuling> check(SEXP expr, const SiteTable& sites) const;
+};
+
+#endif // SITE_RULES_H
@@ -0,0 +1,43 @@
+// SiteTable.cpp
+
+#include "SiteTable.hpp"
+
+// Symbols are installed once; lookups are pointer comparisons
+static const SEXP *flipSymbols()
+{
+    static SEXP symbols[N_FLIP_KINDS];
+    static bool ready = false;
+    if (!ready) {
+        for (int i = 0; i < N_FLIP_KINDS; ++i)
+            symbols[i] = Rf_install(OP_SPECS[i].symbol);
+        ready = true;
+    }
+    return symbols;
+}
+
+bool flipKindOf(SEXP symbol, OpKind *kind)
+{
+    if (TYPEOF(symbol) != SYMSXP)
+        return false;
+
+    const SEXP *symbols = flipSymbols();
+    for (int i = 0; i < N_FLIP_KINDS; ++i) {
+        if (symbols[i] == symbol) {
+            *kind = static_cast<OpKind>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+SEXP replacementSymbol(OpKind kind)
+{
+    static SEXP replacements[N_FLIP_KINDS];
+    static bool ready = false;
+    if (!ready) {
+        for (int i = 0; i < N_FLIP_KINDS; ++i)
+            replacements[i] = Rf_install(OP_SPECS[i].replacement);
+        ready = true;
+    }
+    return kind == OpKind::Delete ? R_NilValue : replacements[static_cast<int>(kind)];
+}
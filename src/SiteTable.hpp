@@ -0,0 +1,156 @@
+// SiteTable.h
+#ifndef SITE_TABLE_H
+#define SITE_TABLE_H
+
+#include <cpp11.hpp>
+#include "AllocStats.hpp"
+#include <R.h>
+#include <Rinternals.h>
+
+// Undefine the 'length' macro defined by Rinternals.h to avoid conflicts with the C++ standard library
+#undef length
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Kind of mutation applied at a site
+enum class OpKind : std::uint8_t {
+    Plus, Minus, Multiply, Divide,
+    Equal, NotEqual, LessThan, MoreThan, LessThanOrEqual, MoreThanOrEqual,
+    And, Or, LogicalAnd, LogicalOr,
+    Delete
+};
+
+// Stateless description of a mutation kind
+struct OpSpec {
+    const char *symbol;       // operator as written in R (nullptr for deletions)
+    const char *replacement;  // operator it is flipped to
+    const char *type;         // name reported to R
+};
+
+// Indexed by OpKind
+constexpr OpSpec OP_SPECS[] = {
+    {"+",  "-",  "PlusOperator"},
+    {"-",  "+",  "MinusOperator"},
+    {"*",  "/",  "MultiplyOperator"},
+    {"/",  "*",  "DivideOperator"},
+    {"==", "!=", "EqualOperator"},
+    {"!=", "==", "NotEqualOperator"},
+    {"<",  ">",  "LessThanOperator"},
+    {">",  "<",  "MoreThanOperator"},
+    {"<=", ">=", "LessThanOrEqualOperator"},
+    {">=", "<=", "MoreThanOrEqualOperator"},
+    {"&",  "|",  "AndOperator"},
+    {"|",  "&",  "OrOperator"},
+    {"&&", "||", "LogicalAndOperator"},
+    {"||", "&&", "LogicalOrOperator"},
+    {nullptr, nullptr, "DeleteOperator"}
+};
+
+constexpr int N_FLIP_KINDS = static_cast<int>(OpKind::Delete);
+
+constexpr const OpSpec& opSpec(OpKind kind) { return OP_SPECS[static_cast<int>(kind)]; }
+
+// Kind of the operator a flip of `kind` writes; `kind` itself for deletions
+inline OpKind flippedKind(OpKind kind)
+{
+    const char *replacement = opSpec(kind).replacement;
+    for (int i = 0; replacement && i < N_FLIP_KINDS; ++i)
+        if (std::strcmp(OP_SPECS[i].symbol, replacement) == 0)
+            return static_cast<OpKind>(i);
+    return kind;
+}
+
+// Flip kind of an operator symbol; returns false if the symbol is not mutated
+bool flipKindOf(SEXP symbol, OpKind *kind);
+
+// Symbol a flip of `kind` writes into the call
+SEXP replacementSymbol(OpKind kind);
+
+// Flat struct-of-arrays table of the mutation sites of one expression.
+// Paths of all sites are packed into a single buffer addressed by offset
+// and length, so gathering does a handful of allocations in total.
+//
+// Next to every path index the table can record the cons cell of the
+// original expression that holds the argument (the spine), and the
+// pre-order index of the site's node. The mutator then reaches the target
+// by pointer instead of counting along CDR chains.
+struct SiteTable {
+    std::vector<OpKind> kind;
+    std::vector<int>    path_offset;
+    std::vector<int>    path_length;
+    std::vector<int>    paths;         // packed path indices of every site
+    std::vector<SEXP>   spine;         // packed argument cells, same layout as paths
+    std::vector<int>    node_index;    // pre-order index of the node, -1 if unknown
+    std::vector<SEXP>   original;      // operator symbol or node to delete
+
+    std::vector<int> start_line;
+    std::vector<int> start_col;
+    std::vector<int> end_line;
+    std::vector<int> end_col;
+
+    int size() const { return static_cast<int>(kind.size()); }
+
+    const int *pathData(int i) const { return paths.data() + path_offset[i]; }
+
+    const SEXP *spineData(int i) const { return spine.data() + path_offset[i]; }
+
+    // Cell of the original expression holding the site's node; R_NilValue
+    // for the root or when no spine was recorded
+    SEXP anchor(int i) const {
+        return path_length[i] == 0 ? R_NilValue : spineData(i)[path_length[i] - 1];
+    }
+
+    bool hasSpine(int i) const { return path_length[i] == 0 || anchor(i) != R_NilValue; }
+
+    // The site's node in the original expression
+    SEXP target(SEXP expr, int i) const {
+        return path_length[i] == 0 ? expr : CAR(anchor(i));
+    }
+
+    std::vector<int> path(int i) const {
+        return std::vector<int>(pathData(i), pathData(i) + path_length[i]);
+    }
+
+    void add(OpKind k, const std::vector<int>& p, SEXP orig,
+             int sl, int sc, int el, int ec)
+    {
+        add(k, p, nullptr, -1, orig, sl, sc, el, ec);
+    }
+
+    void add(OpKind k, const std::vector<int>& p, const SEXP *cells, int node,
+             SEXP orig, int sl, int sc, int el, int ec)
+    {
+        kind.push_back(k);
+        path_offset.push_back(static_cast<int>(paths.size()));
+        path_length.push_back(static_cast<int>(p.size()));
+        paths.insert(paths.end(), p.begin(), p.end());
+        if (cells)
+            spine.insert(spine.end(), cells, cells + p.size());
+        else
+            spine.insert(spine.end(), p.size(), R_NilValue);
+        node_index.push_back(node);
+        original.push_back(orig);
+        start_line.push_back(sl); start_col.push_back(sc);
+        end_line.push_back(el);   end_col.push_back(ec);
+    }
+
+    // Count the columns with AllocStats once the table is filled
+    void countBuffers() const
+    {
+        AllocStats::buffer(kind);
+        AllocStats::buffer(path_offset);
+        AllocStats::buffer(path_length);
+        AllocStats::buffer(paths);
+        AllocStats::buffer(spine);
+        AllocStats::buffer(node_index);
+        AllocStats::buffer(original);
+        AllocStats::buffer(start_line);
+        AllocStats::buffer(start_col);
+        AllocStats::buffer(end_line);
+        AllocStats::buffer(end_col);
+    }
+};
+
+#endif // SITE_TABLE_H
@@ -0,0 +1,84 @@
+// SourcePatcher.cpp
+
+#include <cstring>
+#include "SourcePatcher.hpp"
+
+static inline bool isContinuationByte(unsigned char b)
+{
+    return b >= 0x80 && b <= 0xBF;
+}
+
+size_t SourcePatcher::lineStart(int line) const
+{
+    size_t pos = 0;
+    for (int l = 1; l < line; ++l) {
+        const void *nl = std::memchr(_src + pos, '\n', _size - pos);
+        if (!nl)
+            return _size + 1;
+        pos = static_cast<const char *>(nl) - _src + 1;
+    }
+    return pos;
+}
+
+bool SourcePatcher::column(size_t start, int col, size_t *begin, size_t *end) const
+{
+    // mirrors the column bookkeeping of R's parser (xxgetc in gram.y)
+    int cur = 0;
+    for (size_t k = start; k < _size && _src[k] != '\n'; ++k) {
+        const unsigned char b = static_cast<unsigned char>(_src[k]);
+        if (isContinuationByte(b))
+            continue;
+        ++cur;
+        if (b == '\t')
+            cur = (cur + 7) & ~7;
+        if (cur == col) {
+            size_t e = k + 1;
+            while (e < _size && isContinuationByte(static_cast<unsigned char>(_src[e])))
+                ++e;
+            *begin = k;
+            *end = e;
+            return true;
+        }
+        if (cur > col)
+            return false;
+    }
+    return false;
+}
+
+bool SourcePatcher::resolve(const SourceSpan& span, size_t *from, size_t *to) const
+{
+    if (span.line1 < 1 || span.line2 < span.line1 || span.col1 < 1 || span.col2 < 1)
+        return false;
+
+    size_t first = lineStart(span.line1);
+    size_t last = span.line2 == span.line1 ? first : lineStart(span.line2);
+    if (first > _size || last > _size)
+        return false;
+
+    size_t begin, end, unused;
+    if (!column(first, span.col1, &begin, &unused) || !column(last, span.col2, &unused, &end))
+        return false;
+    if (end <= begin)
+        return false;
+
+    *from = begin;
+    *to = end;
+    return true;
+}
+
+void SourcePatcher::write(size_t from, size_t to, const char *replacement, size_t n_replacement,
+                          char *out) const
+{
+    std::memcpy(out, _src, from);
+    std::memcpy(out + from, replacement, n_replacement);
+    std::memcpy(out + from + n_replacement, _src + to, _size - to);
+}
+
+bool SourcePatcher::write(size_t from, size_t to, const char *replacement, size_t n_replacement,
+                          std::ostream& out) const
+{
+    out.write(_src, static_cast<std::streamsize>(from));
+    out.write(replacement, static_cast<std::streamsize>(n_replacement));
+    out.write(_src + to, static_cast<std::streamsize>(_size - to));
+    return static_cast<bool>(out);
+}
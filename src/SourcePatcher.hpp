@@ -0,0 +1,42 @@
+// SourcePatcher.h
+#ifndef SOURCE_PATCHER_H
+#define SOURCE_PATCHER_H
+
+#include <cstddef>
+#include <ostream>
+#include "ParseDataIndex.hpp"
+
+// Writes a mutant file as the original bytes with one range replaced.
+// Ranges use the positions of R's parse data: 1-based lines and columns,
+// where a column counts characters and a tab advances to the next multiple
+// of 8. The source is assumed to be UTF-8.
+class SourcePatcher {
+public:
+    SourcePatcher(const char *src, size_t size) : _src(src), _size(size) {}
+    ~SourcePatcher() = default;
+
+    // Resolve `span` to the byte range [from, to); false if it is not in the file
+    bool resolve(const SourceSpan& span, size_t *from, size_t *to) const;
+
+    size_t patchedSize(size_t from, size_t to, size_t n_replacement) const {
+        return _size - (to - from) + n_replacement;
+    }
+
+    // Splice `replacement` over [from, to) into `out`, which must hold
+    // patchedSize() bytes
+    void write(size_t from, size_t to, const char *replacement, size_t n_replacement,
+               char *out) const;
+    bool write(size_t from, size_t to, const char *replacement, size_t n_replacement,
+               std::ostream& out) const;
+
+private:
+    const char *_src;
+    size_t _size;
+
+    // First byte of `line`, _size + 1 if the file is shorter
+    size_t lineStart(int line) const;
+    // Byte range of the character at `col` on the line starting at `start`
+    bool column(size_t start, int col, size_t *begin, size_t *end) const;
+};
+
+#endif // SOURCE_PATCHER_H
@@ -5,12 +5,45 @@
 // Declare the function
 extern SEXP C_mutate_single(SEXP expr_sexp);
 
-extern SEXP C_mutate_file(SEXP exprs);
+extern SEXP C_mutate_file(SEXP exprs, SEXP validate, SEXP budget, SEXP seed, SEXP strategy);
+
+extern SEXP C_mutation_sites(SEXP exprs);
+
+extern SEXP C_build_mutant(SEXP exprs, SEXP sites, SEXP site_id, SEXP validate, SEXP hashes);
+
+extern SEXP C_patch_source(SEXP src, SEXP span, SEXP replacement, SEXP original, SEXP out);
+
+extern SEXP C_mutate_schemata(SEXP exprs, SEXP first_id);
+
+extern SEXP C_hash_exprs(SEXP exprs);
+
+extern SEXP C_sample_sites(SEXP strata, SEXP budget, SEXP seed);
+
+extern SEXP C_mutant_stream(SEXP exprs, SEXP validate, SEXP budget, SEXP seed, SEXP strategy,
+                            SEXP site_ids);
+
+extern SEXP C_stream_next(SEXP stream);
+
+extern SEXP C_stream_next_batch(SEXP stream, SEXP n);
+
+extern SEXP C_scan_sites(SEXP files, SEXP threads);
+extern SEXP C_alloc_counters(SEXP enable, SEXP reset);
 
 // Define the registration table
 static const R_CallMethodDef CallEntries[] = {
     {"C_mutate_single", (DL_FUNC) &C_mutate_single, 1},  // Function name, pointer, and number of arguments
-    {"C_mutate_file", (DL_FUNC) &C_mutate_file, 1},      // Added entry for C_mutate_file
+    {"C_mutate_file", (DL_FUNC) &C_mutate_file, 5},      // Added entry for C_mutate_file
+    {"C_mutation_sites", (DL_FUNC) &C_mutation_sites, 1},
+    {"C_build_mutant", (DL_FUNC) &C_build_mutant, 5},
+    {"C_patch_source", (DL_FUNC) &C_patch_source, 5},
+    {"C_mutate_schemata", (DL_FUNC) &C_mutate_schemata, 2},
+    {"C_hash_exprs", (DL_FUNC) &C_hash_exprs, 1},
+    {"C_sample_sites", (DL_FUNC) &C_sample_sites, 3},
+    {"C_mutant_stream", (DL_FUNC) &C_mutant_stream, 6},
+    {"C_stream_next", (DL_FUNC) &C_stream_next, 1},
+    {"C_stream_next_batch", (DL_FUNC) &C_stream_next_batch, 2},
+    {"C_scan_sites", (DL_FUNC) &C_scan_sites, 2},
+    {"C_alloc_counters", (DL_FUNC) &C_alloc_counters, 2},
     {NULL, NULL, 0}
 };
 
@@ -12,6 +12,8 @@
 #include <fstream>
 #include <sstream>
 #include <string>
+#include <cstring>
+#include <algorithm>
 #include <regex>
 #include <vector>
 #include <unordered_set>
@@ -21,29 +23,36 @@
 #include <Rinternals.h>
 #include "ASTHandler.hpp"
 #include "Mutator.hpp"
+#include "MutantValidator.hpp"
+#include "ParseDataIndex.hpp"
+#include "SourcePatcher.hpp"
+#include "SchemataBuilder.hpp"
+#include "AstHash.hpp"
+#include "SiteRules.hpp"
+#include "MutantSampler.hpp"
+#include "MutantStream.hpp"
+#include "RScanner.hpp"
+#include "AllocStats.hpp"
+#include <unordered_set>
 #include <vector>
 
-extern "C" SEXP C_mutate_single(SEXP expr_sexp, SEXP src_ref_sexp, bool is_inside_block)
+static SEXP mutateExpression(SEXP expr_sexp, SEXP src_ref_sexp, bool is_inside_block,
+                             const ParseDataIndex *index)
 {
-    if (TYPEOF(expr_sexp) == EXPRSXP) {
-        if (Rf_length(expr_sexp) == 0)
-            Rf_error("EXPRSXP input has no expressions.");
-        expr_sexp = VECTOR_ELT(expr_sexp, 0);
-    }
-
     ASTHandler astHandler;
-    std::vector<OperatorPos> operators =
-        astHandler.gatherOperators(expr_sexp, src_ref_sexp, is_inside_block);
+    SiteTable operators =
+        astHandler.gatherOperators(expr_sexp, src_ref_sexp, is_inside_block, index);
 
-    const int n = static_cast<int>(operators.size());
+    const int n = operators.size();
     if (n == 0) {
-        return Rf_allocVector(VECSXP, 0);     // no PROTECT needed – no alloc yet
+        return AllocStats::sexp(Rf_allocVector(VECSXP, 0));   // no PROTECT needed – no alloc yet
     }
 
     Mutator mutator;
 
     // protect every mutant until we have copied it into the result list
     std::vector<SEXP> mutants;  mutants.reserve(n);
+    AllocStats::buffer(mutants);
     int n_protected = 0;
 
     for (int i = 0; i < n; ++i) {
@@ -57,7 +66,7 @@ extern "C" SEXP C_mutate_single(SEXP expr_sexp, SEXP src_ref_sexp, bool is_insid
     }
 
     const R_xlen_t m = static_cast<R_xlen_t>(mutants.size());
-    SEXP res = PROTECT(Rf_allocVector(VECSXP, m)); ++n_protected;
+    SEXP res = PROTECT(AllocStats::sexp(Rf_allocVector(VECSXP, m))); ++n_protected;
     for (R_xlen_t i = 0; i < m; ++i)
         SET_VECTOR_ELT(res, i, mutants[i]);
 
@@ -66,11 +75,23 @@ extern "C" SEXP C_mutate_single(SEXP expr_sexp, SEXP src_ref_sexp, bool is_insid
     return res;
 }
 
-static bool isValidMutant(SEXP mutant)
+extern "C" SEXP C_mutate_single(SEXP expr_sexp, SEXP src_ref_sexp, bool is_inside_block)
 {
-    int error = 0;
-    R_tryEval(mutant, R_GlobalEnv, &error);
-    return error == 0;
+    AllocScope scope("C_mutate_single");
+    if (TYPEOF(expr_sexp) == EXPRSXP) {
+        if (Rf_length(expr_sexp) == 0)
+            Rf_error("EXPRSXP input has no expressions.");
+        expr_sexp = VECTOR_ELT(expr_sexp, 0);
+    }
+
+    return scope.done(mutateExpression(expr_sexp, src_ref_sexp, is_inside_block, nullptr));
+}
+
+// Check the file with `replacement` standing in for expression `expr_index`
+bool isValidMutant(SEXP exprs, int expr_index, SEXP replacement,
+                   ValidationMode mode = ValidationMode::Syntax)
+{
+    return MutantValidator(mode).isValid(exprs, expr_index, replacement);
 }
 
 std::vector<bool> detect_block_expressions(SEXP exprs, int n_expr) {
@@ -116,7 +137,24 @@ std::vector<bool> detect_block_expressions(SEXP exprs, int n_expr) {
     return block_flags;
 }
 
-extern "C" SEXP C_mutate_file(SEXP exprs)
+/*
+ * A file mutant is stored as a delta against the parsed file: the index of
+ * the mutated top-level expression and its replacement. Consumers apply it
+ * themselves, so building one never touches the other expressions.
+ */
+static SEXP makeMutantDelta(int expr_index, SEXP mut)
+{
+    static const char *names[] = {"expr_index", "replacement", ""};
+    SEXP delta = PROTECT(AllocStats::sexp(Rf_mkNamed(VECSXP, names)));
+    SET_VECTOR_ELT(delta, 0, AllocStats::sexp(Rf_ScalarInteger(expr_index + 1)));
+    SET_VECTOR_ELT(delta, 1, mut);
+    Rf_setAttrib(delta, Rf_install("mutation_info"),
+                 Rf_getAttrib(mut, Rf_install("mutation_info")));
+    UNPROTECT(1);
+    return delta;
+}
+
+static SEXP getSrcRefs(SEXP exprs)
 {
     if (TYPEOF(exprs) != EXPRSXP)
         Rf_error("Input must be an expression list (EXPRSXP).");
@@ -124,54 +162,646 @@ extern "C" SEXP C_mutate_file(SEXP exprs)
     SEXP src_ref = Rf_getAttrib(exprs, Rf_install("srcref"));
     if (TYPEOF(src_ref) != VECSXP || Rf_length(src_ref) != Rf_length(exprs))
         Rf_error("'srcref' attribute missing or malformed.");
+    return src_ref;
+}
+
+static void setHashAttrib(SEXP delta, std::uint64_t program)
+{
+    SEXP hash = PROTECT(AllocStats::sexp(Rf_mkString(AstHasher::hex(program).c_str())));
+    Rf_setAttrib(delta, Rf_install("hash"), hash);
+    UNPROTECT(1);
+}
+
+/*
+ * Structural hashes of a parsed file, as an opaque raw vector holding the
+ * program hash followed by one hash per top-level expression. The program
+ * hash is also given in hex in the "program" attribute, the form mutant
+ * deltas carry in their "hash" attribute.
+ */
+extern "C" SEXP C_hash_exprs(SEXP exprs)
+{
+    AllocScope scope("C_hash_exprs");
+    if (TYPEOF(exprs) != EXPRSXP)
+        Rf_error("Input must be an expression list (EXPRSXP).");
+
+    const int n_expr = Rf_length(exprs);
+    AstHasher hasher;
+    std::vector<std::uint64_t> hashes(n_expr);
+    for (int i = 0; i < n_expr; ++i)
+        hashes[i] = hasher.hash(VECTOR_ELT(exprs, i));
+    const std::uint64_t program = AstHasher::programHash(hashes);
+
+    SEXP res = PROTECT(Rf_allocVector(RAWSXP, (n_expr + 1) * sizeof(std::uint64_t)));
+    std::memcpy(RAW(res), &program, sizeof(program));
+    if (n_expr > 0)
+        std::memcpy(RAW(res) + sizeof(program), hashes.data(), n_expr * sizeof(std::uint64_t));
+    SEXP hex = PROTECT(Rf_mkString(AstHasher::hex(program).c_str()));
+    Rf_setAttrib(res, Rf_install("program"), hex);
+    UNPROTECT(2);
+    return scope.done(res);
+}
+
+// Budget of C_mutate_file / C_sample_sites: NULL or NA for no limit
+static int budgetFromR(SEXP budget)
+{
+    if (budget == R_NilValue)
+        return -1;
+    const int b = Rf_asInteger(budget);
+    if (b == NA_INTEGER)
+        return -1;
+    if (b < 0)
+        Rf_error("'budget' must be a non-negative integer.");
+    return b;
+}
+
+static std::uint64_t seedFromR(SEXP seed)
+{
+    if (seed == R_NilValue)
+        return 0;
+    const double s = Rf_asReal(seed);
+    if (ISNAN(s))
+        Rf_error("'seed' must be a number.");
+    return static_cast<std::uint64_t>(static_cast<std::int64_t>(s));
+}
+
+// Delta of a streamed mutant with its site row and program hash; the
+// mutant's protection is handed over to the returned delta
+static SEXP streamedDelta(const StreamedMutant& m)
+{
+    SEXP delta = makeMutantDelta(m.expr_index, m.mutant);
+    UNPROTECT(1);                              // mut is reachable from delta
+    PROTECT(delta);
+    SEXP site_id = PROTECT(AllocStats::sexp(Rf_ScalarInteger(m.site_row + 1)));
+    Rf_setAttrib(delta, Rf_install("site_id"), site_id);
+    UNPROTECT(1);
+    setHashAttrib(delta, m.program);
+    return delta;
+}
+
+static void finalizeMutantStream(SEXP ptr)
+{
+    delete static_cast<MutantStream *>(R_ExternalPtrAddr(ptr));
+    R_ClearExternalPtr(ptr);
+}
+
+// A sampled stream behind an external pointer that is made, with its
+// finalizer, before the stream: an error while the stream builds its sites
+// or later on still frees it. The pointer is left protected.
+static SEXP newMutantStream(SEXP exprs, SEXP validate, SEXP budget, SEXP seed,
+                            SEXP strategy)
+{
+    SEXP src_ref = getSrcRefs(exprs);
+    const ValidationMode mode = MutantValidator::modeFromR(validate);
+    const MutantSampler sampler(budgetFromR(budget), seedFromR(seed));
+    const SampleStrategy how = MutantSampler::strategyFromR(strategy);
+
+    SEXP ptr = PROTECT(R_MakeExternalPtr(NULL, Rf_install("MutantStream"), exprs));
+    R_RegisterCFinalizerEx(ptr, finalizeMutantStream, TRUE);
 
     const int n_expr = Rf_length(exprs);
     std::vector<bool> inside_block = detect_block_expressions(exprs, n_expr);
+    MutantStream *stream = new MutantStream(exprs, src_ref, inside_block, mode);
+    R_SetExternalPtrAddr(ptr, stream);
+    AllocStats::heap(sizeof(MutantStream));
+    stream->sample(sampler, how);
+    return ptr;
+}
 
-    // we will collect *protected* mutants and unprotect them after transferring
-    std::vector<SEXP> valid_mutants;
-    int n_protected = 0;
+/*
+ * Mutants of a parsed file as deltas against it. Sites the static rules
+ * prove equivalent are left out. With a `budget` only that many sites are
+ * drawn, per `strategy` ("uniform", "type" or "function") and `seed`, and
+ * only the drawn ones are materialised; duplicates and invalid mutants among
+ * them are dropped, so fewer than `budget` deltas can come back.
+ */
+extern "C" SEXP C_mutate_file(SEXP exprs, SEXP validate, SEXP budget, SEXP seed,
+                              SEXP strategy)
+{
+    AllocScope scope("C_mutate_file");
+    SEXP ptr = newMutantStream(exprs, validate, budget, seed, strategy);
+    MutantStream *stream = static_cast<MutantStream *>(R_ExternalPtrAddr(ptr));
+
+    // deltas go into the result as they are made, so the protect stack does
+    // not grow with the file; invalid and repeated mutants leave it shorter
+    SEXP res = PROTECT(AllocStats::sexp(Rf_allocVector(VECSXP, stream->remaining())));
+    R_xlen_t n_valid = 0;
+    StreamedMutant m;
+    while (stream->next(&m)) {
+        SET_VECTOR_ELT(res, n_valid++, streamedDelta(m));
+        UNPROTECT(1);
+    }
+    if (n_valid < Rf_xlength(res))
+        res = AllocStats::sexp(Rf_xlengthgets(res, n_valid));
+    finalizeMutantStream(ptr);                 // drained; no need to wait for the GC
+    UNPROTECT(2);
+    return scope.done(res);
+}
+
+static MutantStream *streamFromR(SEXP ptr)
+{
+    if (TYPEOF(ptr) != EXTPTRSXP || R_ExternalPtrTag(ptr) != Rf_install("MutantStream"))
+        Rf_error("'stream' must be a mutant stream.");
+    MutantStream *stream = static_cast<MutantStream *>(R_ExternalPtrAddr(ptr));
+    if (!stream)
+        Rf_error("The mutant stream has been released.");
+    return stream;
+}
+
+/*
+ * Mutant generator over a parsed file, as an external pointer for
+ * C_stream_next and C_stream_next_batch. Takes the arguments of
+ * C_mutate_file; `site_ids` (1-based rows of C_mutation_sites, or NULL)
+ * restricts it to those sites in that order instead of sampling. The
+ * pointer keeps `exprs` alive; the generator is freed with it.
+ */
+extern "C" SEXP C_mutant_stream(SEXP exprs, SEXP validate, SEXP budget, SEXP seed,
+                                SEXP strategy, SEXP site_ids)
+{
+    AllocScope scope("C_mutant_stream");
+    if (site_ids != R_NilValue && TYPEOF(site_ids) != INTSXP)
+        Rf_error("'site_ids' must be an integer vector.");
+
+    SEXP ptr = newMutantStream(exprs, validate, budget, seed, strategy);
+    MutantStream *stream = static_cast<MutantStream *>(R_ExternalPtrAddr(ptr));
+    if (site_ids != R_NilValue) {
+        std::vector<int> rows(Rf_length(site_ids));
+        for (int k = 0; k < Rf_length(site_ids); ++k)
+            rows[k] = INTEGER(site_ids)[k] - 1;
+        AllocStats::buffer(rows);
+        stream->restrict(rows);
+    }
+
+    SEXP candidates = PROTECT(Rf_ScalarInteger(stream->remaining()));
+    Rf_setAttrib(ptr, Rf_install("candidates"), candidates);
+    UNPROTECT(2);
+    return scope.done(ptr);
+}
+
+// Next mutant delta of a stream, NULL once it is exhausted
+extern "C" SEXP C_stream_next(SEXP ptr)
+{
+    AllocScope scope("C_stream_next");
+    StreamedMutant m;
+    if (!streamFromR(ptr)->next(&m))
+        return scope.done(R_NilValue);
+    SEXP delta = streamedDelta(m);
+    UNPROTECT(1);
+    return scope.done(delta);
+}
+
+// Up to `n` further mutant deltas of a stream; an empty list once it is exhausted
+extern "C" SEXP C_stream_next_batch(SEXP ptr, SEXP n)
+{
+    AllocScope scope("C_stream_next_batch");
+    MutantStream *stream = streamFromR(ptr);
+    const int batch = Rf_asInteger(n);
+    if (batch == NA_INTEGER || batch < 1)
+        Rf_error("'n' must be a positive integer.");
+
+    // every delta goes into the result as it is made, so the protect stack
+    // does not grow with `n`; the stream cannot yield more than it has left
+    SEXP res = PROTECT(AllocStats::sexp(
+        Rf_allocVector(VECSXP, std::min(batch, stream->remaining()))));
+    R_xlen_t n_out = 0;
+    StreamedMutant m;
+    while (n_out < Rf_xlength(res) && stream->next(&m)) {
+        SET_VECTOR_ELT(res, n_out++, streamedDelta(m));
+        UNPROTECT(1);
+    }
+    if (n_out < Rf_xlength(res))
+        res = AllocStats::sexp(Rf_xlengthgets(res, n_out));
+    UNPROTECT(1);
+    return scope.done(res);
+}
+
+/*
+ * Draw at most `budget` of the rows described by `strata` (one stratum id per
+ * row; NULL for uniform sampling) with `seed`. Returns the 1-based rows in
+ * increasing order with the number of rows each one stands for in the
+ * "weight" attribute.
+ */
+extern "C" SEXP C_sample_sites(SEXP strata, SEXP budget, SEXP seed)
+{
+    if (strata != R_NilValue && TYPEOF(strata) != INTSXP)
+        Rf_error("'strata' must be an integer vector.");
+    const int n = strata == R_NilValue ? 0 : Rf_length(strata);
+    std::vector<int> keys(n);
+    for (int i = 0; i < n; ++i)
+        keys[i] = INTEGER(strata)[i];
+
+    std::vector<double> weight;
+    std::vector<int> picked = MutantSampler(budgetFromR(budget), seedFromR(seed)).select(keys, &weight);
+
+    const R_xlen_t m = static_cast<R_xlen_t>(picked.size());
+    SEXP res = PROTECT(Rf_allocVector(INTSXP, m));
+    SEXP w = PROTECT(Rf_allocVector(REALSXP, m));
+    for (R_xlen_t k = 0; k < m; ++k) {
+        INTEGER(res)[k] = picked[k] + 1;
+        REAL(w)[k] = weight[k];
+    }
+    Rf_setAttrib(res, Rf_install("weight"), w);
+    UNPROTECT(2);
+    return res;
+}
+
+/*
+ * Write a mutant file by splicing `replacement` over a parse-data range
+ * (line1, col1, line2, col2) of the original file bytes. `out` is a path the
+ * patched file is streamed to, a raw buffer that is filled in place, or NULL
+ * for a new raw vector; for a path or a buffer the number of bytes written is
+ * returned. When `original` is given the range must hold exactly that text.
+ * Returns NULL if the range does not apply to the file.
+ */
+extern "C" SEXP C_patch_source(SEXP src, SEXP span, SEXP replacement, SEXP original, SEXP out)
+{
+    if (TYPEOF(src) != RAWSXP)
+        Rf_error("'src' must be a raw vector of the file contents.");
+    if (TYPEOF(span) != INTSXP || Rf_length(span) != 4)
+        Rf_error("'span' must be an integer vector of length 4.");
+    if (TYPEOF(replacement) != STRSXP || Rf_length(replacement) != 1)
+        Rf_error("'replacement' must be a single string.");
+
+    const char *src_bytes = reinterpret_cast<const char *>(RAW(src));
+    SourcePatcher patcher(src_bytes, Rf_xlength(src));
+
+    const int *s = INTEGER(span);
+    size_t from, to;
+    if (!patcher.resolve({s[0], s[1], s[2], s[3]}, &from, &to))
+        return R_NilValue;
 
+    if (original != R_NilValue) {
+        if (TYPEOF(original) != STRSXP || Rf_length(original) != 1)
+            Rf_error("'original' must be NULL or a single string.");
+        const char *expected = Rf_translateCharUTF8(STRING_ELT(original, 0));
+        if (std::strlen(expected) != to - from ||
+            std::memcmp(src_bytes + from, expected, to - from) != 0)
+            return R_NilValue;
+    }
+
+    const char *repl = Rf_translateCharUTF8(STRING_ELT(replacement, 0));
+    const size_t n_repl = std::strlen(repl);
+    const size_t n_out = patcher.patchedSize(from, to, n_repl);
+
+    if (out == R_NilValue) {
+        SEXP res = PROTECT(Rf_allocVector(RAWSXP, n_out));
+        patcher.write(from, to, repl, n_repl, reinterpret_cast<char *>(RAW(res)));
+        UNPROTECT(1);
+        return res;
+    }
+    if (TYPEOF(out) == RAWSXP) {
+        if (static_cast<size_t>(Rf_xlength(out)) < n_out)
+            Rf_error("Output buffer holds %lld bytes, the mutant needs %lld.",
+                     static_cast<long long>(Rf_xlength(out)), static_cast<long long>(n_out));
+        patcher.write(from, to, repl, n_repl, reinterpret_cast<char *>(RAW(out)));
+        return Rf_ScalarReal(static_cast<double>(n_out));
+    }
+    if (TYPEOF(out) == STRSXP && Rf_length(out) == 1) {
+        bool ok;
+        {
+            // closed before any R error can longjmp over it
+            std::ofstream file(R_ExpandFileName(Rf_translateChar(STRING_ELT(out, 0))),
+                               std::ios::binary | std::ios::trunc);
+            ok = file && patcher.write(from, to, repl, n_repl, file);
+        }
+        if (!ok)
+            Rf_error("Cannot write '%s'.", CHAR(STRING_ELT(out, 0)));
+        return Rf_ScalarReal(static_cast<double>(n_out));
+    }
+    Rf_error("'out' must be NULL, a raw buffer or a file path.");
+}
+
+/*
+ * Descriptor table of every mutation site in a parsed file. Only the sites
+ * are returned, no mutant is built; C_build_mutant materialises a single row
+ * on demand from the same parse.
+ */
+extern "C" SEXP C_mutation_sites(SEXP exprs)
+{
+    AllocScope scope("C_mutation_sites");
+    SEXP src_ref = getSrcRefs(exprs);
+
+    const int n_expr = Rf_length(exprs);
+    std::vector<bool> inside_block = detect_block_expressions(exprs, n_expr);
+    const ParseDataIndex index(exprs);
+
+    // gather every table first, the R columns are allocated once at the end
+    std::vector<SiteTable> tables;
+    std::vector<std::vector<SiteRuling>> rulings;
+    tables.reserve(n_expr);
+    rulings.reserve(n_expr);
+    int n = 0;
     for (int i = 0; i < n_expr; ++i) {
-        SEXP cur_expr     = VECTOR_ELT(exprs, i);
-        SEXP cur_src_ref  = VECTOR_ELT(src_ref, i);
-
-        SEXP cur_mutants  = C_mutate_single(cur_expr, cur_src_ref, inside_block[i]);
-        if (TYPEOF(cur_mutants) != VECSXP)
-            Rf_error("C_mutate_single did not return a list for expression %d.", i);
-
-        const int n_mut   = Rf_length(cur_mutants);
-        for (int j = 0; j < n_mut; ++j) {
-            SEXP file_mut = PROTECT(Rf_allocVector(EXPRSXP, n_expr)); ++n_protected;
-            SEXP mut_info = R_NilValue;
-
-            for (int k = 0; k < n_expr; ++k) {
-                if (k == i) {
-                    SEXP mut = VECTOR_ELT(cur_mutants, j);
-                    SET_VECTOR_ELT(file_mut, k, mut);
-                    mut_info = Rf_getAttrib(mut, Rf_install("mutation_info"));
-                } else {
-                    SET_VECTOR_ELT(file_mut, k, VECTOR_ELT(exprs, k));
-                }
-            }
-            Rf_setAttrib(file_mut, Rf_install("mutation_info"), mut_info);
+        ASTHandler astHandler;
+        tables.push_back(astHandler.gatherOperators(VECTOR_ELT(exprs, i),
+                                                    VECTOR_ELT(src_ref, i),
+                                                    inside_block[i], &index));
+        rulings.push_back(SiteRules().check(VECTOR_ELT(exprs, i), tables.back()));
+        n += tables.back().size();
+    }
 
-            if (isValidMutant(file_mut))
-                valid_mutants.push_back(file_mut); // still protected
-            else {
-                UNPROTECT(1); --n_protected;       // discard invalid mutant
-            }
+    static const char *names[] = {"site_id", "expr_index", "op_index", "in_block",
+                                  "path", "type", "start_line", "start_col",
+                                  "end_line", "end_col", "node_index",
+                                  "original", "replacement", "verdict", "rule"};
+    const int n_col = sizeof(names) / sizeof(names[0]);
+
+    SEXP res = PROTECT(Rf_allocVector(VECSXP, n_col));
+    SEXP col_names = PROTECT(Rf_allocVector(STRSXP, n_col));
+    for (int c = 0; c < n_col; ++c) {
+        SET_STRING_ELT(col_names, c, Rf_mkChar(names[c]));
+        SEXPTYPE type = c == 3 ? LGLSXP : c == 4 ? VECSXP : (c == 5 || c >= 11) ? STRSXP : INTSXP;
+        SET_VECTOR_ELT(res, c, Rf_allocVector(type, n));
+    }
+
+    int r = 0;
+    for (int i = 0; i < n_expr; ++i) {
+        const SiteTable &ops = tables[i];
+        for (int j = 0; j < ops.size(); ++j, ++r) {
+            INTEGER(VECTOR_ELT(res, 0))[r] = r + 1;
+            INTEGER(VECTOR_ELT(res, 1))[r] = i + 1;
+            INTEGER(VECTOR_ELT(res, 2))[r] = j + 1;
+            LOGICAL(VECTOR_ELT(res, 3))[r] = inside_block[i];
+
+            SEXP path = Rf_allocVector(INTSXP, ops.path_length[j]);
+            SET_VECTOR_ELT(VECTOR_ELT(res, 4), r, path);
+            std::copy(ops.pathData(j), ops.pathData(j) + ops.path_length[j], INTEGER(path));
+
+            SET_STRING_ELT(VECTOR_ELT(res, 5), r, Rf_mkChar(opSpec(ops.kind[j]).type));
+            INTEGER(VECTOR_ELT(res, 6))[r] = ops.start_line[j];
+            INTEGER(VECTOR_ELT(res, 7))[r] = ops.start_col[j];
+            INTEGER(VECTOR_ELT(res, 8))[r] = ops.end_line[j];
+            INTEGER(VECTOR_ELT(res, 9))[r] = ops.end_col[j];
+            INTEGER(VECTOR_ELT(res, 10))[r] = ops.node_index[j] + 1;
+
+            // source text of a flip, so writers can patch the token in place
+            const OpSpec &spec = opSpec(ops.kind[j]);
+            SET_STRING_ELT(VECTOR_ELT(res, 11), r, spec.symbol ? Rf_mkChar(spec.symbol) : NA_STRING);
+            SET_STRING_ELT(VECTOR_ELT(res, 12), r, spec.replacement ? Rf_mkChar(spec.replacement) : NA_STRING);
+
+            // what the static rules know about the mutant
+            const SiteRuling &ruling = rulings[i][j];
+            SET_STRING_ELT(VECTOR_ELT(res, 13), r, Rf_mkChar(verdictName(ruling.verdict)));
+            SET_STRING_ELT(VECTOR_ELT(res, 14), r, ruling.rule ? Rf_mkChar(ruling.rule) : NA_STRING);
         }
     }
 
-    // Build the final R list
-    const R_xlen_t n_valid = static_cast<R_xlen_t>(valid_mutants.size());
-    SEXP res = PROTECT(Rf_allocVector(VECSXP, n_valid)); ++n_protected;
+    SEXP row_names = PROTECT(Rf_allocVector(INTSXP, 2));
+    INTEGER(row_names)[0] = NA_INTEGER;
+    INTEGER(row_names)[1] = -n;
 
-    for (R_xlen_t i = 0; i < n_valid; ++i)
-        SET_VECTOR_ELT(res, i, valid_mutants[i]);
+    Rf_setAttrib(res, R_NamesSymbol, col_names);
+    Rf_setAttrib(res, Rf_install("row.names"), row_names);
+    Rf_setAttrib(res, R_ClassSymbol, Rf_mkString("data.frame"));
 
-    UNPROTECT(n_protected);   // drops all temporaries but keeps res reachable
-    return res;
+    UNPROTECT(3);
+    return scope.done(res);
 }
 
+/*
+ * Mutation sites of R files found by the standalone scanner instead of
+ * parse(), on up to `threads` threads. The table has the columns of
+ * C_mutation_sites plus the file and the byte range of every site (0-based,
+ * end exclusive); site ids count per file. Files that cannot be read or
+ * scanned are left out and named with the reason in the "errors" attribute.
+ */
+extern "C" SEXP C_scan_sites(SEXP files, SEXP threads)
+{
+    AllocScope scope("C_scan_sites");
+    if (TYPEOF(files) != STRSXP)
+        Rf_error("'files' must be a character vector.");
+    const int n_threads = Rf_asInteger(threads);
+    if (n_threads == NA_INTEGER || n_threads < 1)
+        Rf_error("'threads' must be a positive integer.");
+
+    std::vector<std::string> paths;
+    for (int f = 0; f < Rf_length(files); ++f)
+        paths.push_back(Rf_translateCharUTF8(STRING_ELT(files, f)));
+
+    // no R API is touched until every worker has joined
+    const std::vector<ScannedFile> scanned = RScanner().scanFiles(paths, n_threads);
+
+    int n = 0, n_failed = 0;
+    for (const ScannedFile& file : scanned) {
+        n += static_cast<int>(file.sites.size());
+        n_failed += !file.error.empty();
+    }
+
+    static const char *names[] = {"file", "site_id", "expr_index", "op_index", "in_block",
+                                  "path", "type", "start_line", "start_col", "end_line",
+                                  "end_col", "node_index", "original", "replacement",
+                                  "verdict", "rule", "byte_start", "byte_end"};
+    const int n_col = sizeof(names) / sizeof(names[0]);
+    static const SEXPTYPE types[] = {STRSXP, INTSXP, INTSXP, INTSXP, LGLSXP, VECSXP, STRSXP,
+                                     INTSXP, INTSXP, INTSXP, INTSXP, INTSXP, STRSXP, STRSXP,
+                                     STRSXP, STRSXP, INTSXP, INTSXP};
+
+    SEXP res = PROTECT(Rf_allocVector(VECSXP, n_col));
+    SEXP col_names = PROTECT(Rf_allocVector(STRSXP, n_col));
+    for (int c = 0; c < n_col; ++c) {
+        SET_STRING_ELT(col_names, c, Rf_mkChar(names[c]));
+        SET_VECTOR_ELT(res, c, Rf_allocVector(types[c], n));
+    }
+    SEXP errors = PROTECT(Rf_allocVector(STRSXP, n_failed));
+    SEXP error_names = PROTECT(Rf_allocVector(STRSXP, n_failed));
+
+    int r = 0, e = 0;
+    for (std::size_t f = 0; f < scanned.size(); ++f) {
+        const ScannedFile& file = scanned[f];
+        if (!file.error.empty()) {
+            SET_STRING_ELT(errors, e, Rf_mkCharCE(file.error.c_str(), CE_UTF8));
+            SET_STRING_ELT(error_names, e++, STRING_ELT(files, f));
+            continue;
+        }
+        for (int j = 0; j < static_cast<int>(file.sites.size()); ++j, ++r) {
+            const ScannedSite& site = file.sites[j];
+            SET_STRING_ELT(VECTOR_ELT(res, 0), r, STRING_ELT(files, f));
+            INTEGER(VECTOR_ELT(res, 1))[r] = j + 1;
+            INTEGER(VECTOR_ELT(res, 2))[r] = site.expr_index + 1;
+            INTEGER(VECTOR_ELT(res, 3))[r] = site.op_index + 1;
+            LOGICAL(VECTOR_ELT(res, 4))[r] = site.in_block;
+
+            SEXP path = Rf_allocVector(INTSXP, site.path_length);
+            SET_VECTOR_ELT(VECTOR_ELT(res, 5), r, path);
+            std::copy(file.pathData(j), file.pathData(j) + site.path_length, INTEGER(path));
+
+            const OpSpec &spec = opSpec(site.kind);
+            SET_STRING_ELT(VECTOR_ELT(res, 6), r, Rf_mkChar(spec.type));
+            INTEGER(VECTOR_ELT(res, 7))[r] = site.line1;
+            INTEGER(VECTOR_ELT(res, 8))[r] = site.col1;
+            INTEGER(VECTOR_ELT(res, 9))[r] = site.line2;
+            INTEGER(VECTOR_ELT(res, 10))[r] = site.col2;
+            INTEGER(VECTOR_ELT(res, 11))[r] = site.node_index + 1;
+            SET_STRING_ELT(VECTOR_ELT(res, 12), r, spec.symbol ? Rf_mkChar(spec.symbol) : NA_STRING);
+            SET_STRING_ELT(VECTOR_ELT(res, 13), r, spec.replacement ? Rf_mkChar(spec.replacement) : NA_STRING);
+            SET_STRING_ELT(VECTOR_ELT(res, 14), r, Rf_mkChar(verdictName(site.ruling.verdict)));
+            SET_STRING_ELT(VECTOR_ELT(res, 15), r, site.ruling.rule ? Rf_mkChar(site.ruling.rule) : NA_STRING);
+            INTEGER(VECTOR_ELT(res, 16))[r] = site.byte1;
+            INTEGER(VECTOR_ELT(res, 17))[r] = site.byte2;
+        }
+    }
+
+    SEXP row_names = PROTECT(Rf_allocVector(INTSXP, 2));
+    INTEGER(row_names)[0] = NA_INTEGER;
+    INTEGER(row_names)[1] = -n;
+
+    Rf_setAttrib(res, R_NamesSymbol, col_names);
+    Rf_setAttrib(res, Rf_install("row.names"), row_names);
+    Rf_setAttrib(res, R_ClassSymbol, Rf_mkString("data.frame"));
+    Rf_setAttrib(errors, R_NamesSymbol, error_names);
+    Rf_setAttrib(res, Rf_install("errors"), errors);
+
+    UNPROTECT(5);
+    return scope.done(res);
+}
+
+/*
+ * Mutant schema of a parsed file: every expression with all of its sites
+ * folded in behind `.mutant_id == <id>` switches, numbered like the rows of
+ * C_mutation_sites plus `first_id - 1`. Returns the instrumented expressions
+ * and the ids that can be switched on.
+ */
+extern "C" SEXP C_mutate_schemata(SEXP exprs, SEXP first_id)
+{
+    AllocScope scope("C_mutate_schemata");
+    SEXP src_ref = getSrcRefs(exprs);
+    const int offset = Rf_asInteger(first_id);
+    if (offset == NA_INTEGER)
+        Rf_error("'first_id' must be an integer.");
+
+    const int n_expr = Rf_length(exprs);
+    std::vector<bool> inside_block = detect_block_expressions(exprs, n_expr);
+
+    SEXP schema = PROTECT(AllocStats::sexp(Rf_allocVector(EXPRSXP, n_expr)));
+    std::vector<int> ids;
+    SchemataBuilder builder(Rf_install(".mutant_id"));
+    std::vector<bool> embedded;
+
+    int next_id = offset;
+    for (int i = 0; i < n_expr; ++i) {
+        ASTHandler astHandler;
+        SiteTable ops = astHandler.gatherOperators(VECTOR_ELT(exprs, i),
+                                                   VECTOR_ELT(src_ref, i), inside_block[i]);
+        SET_VECTOR_ELT(schema, i, builder.build(VECTOR_ELT(exprs, i), ops, next_id, embedded));
+        // equivalent sites keep their switch but are never turned on
+        std::vector<SiteRuling> rulings = SiteRules().check(VECTOR_ELT(exprs, i), ops);
+        for (int j = 0; j < ops.size(); ++j)
+            if (embedded[j] && rulings[j].verdict != SiteVerdict::Equivalent)
+                ids.push_back(next_id + j);
+        next_id += ops.size();
+    }
+
+    const char *names[] = {"exprs", "site_id", ""};
+    SEXP res = PROTECT(Rf_mkNamed(VECSXP, names));
+    SET_VECTOR_ELT(res, 0, schema);
+    SEXP site_ids = Rf_allocVector(INTSXP, static_cast<R_xlen_t>(ids.size()));
+    SET_VECTOR_ELT(res, 1, site_ids);
+    std::copy(ids.begin(), ids.end(), INTEGER(site_ids));
+
+    UNPROTECT(2);
+    return scope.done(res);
+}
+
+static int siteColumn(SEXP sites, const char *name, int row)
+{
+    SEXP names = Rf_getAttrib(sites, R_NamesSymbol);
+    for (int c = 0; c < Rf_length(names); ++c) {
+        if (std::strcmp(CHAR(STRING_ELT(names, c)), name) == 0) {
+            SEXP col = VECTOR_ELT(sites, c);
+            if (row >= Rf_length(col))
+                Rf_error("Site %d is out of range.", row + 1);
+            return TYPEOF(col) == LGLSXP ? LOGICAL(col)[row] : INTEGER(col)[row];
+        }
+    }
+    Rf_error("Site table has no '%s' column.", name);
+}
+
+/*
+ * Build the mutant delta for one row of the C_mutation_sites table, or the
+ * higher-order mutant of several rows of the same expression.
+ * Returns NULL when the mutation cannot be applied or is not a valid program.
+ * With the C_hash_exprs result of the file as `hashes`, the delta carries the
+ * mutated program's hash in its "hash" attribute.
+ */
+extern "C" SEXP C_build_mutant(SEXP exprs, SEXP sites, SEXP site_id, SEXP validate,
+                               SEXP hashes)
+{
+    AllocScope scope("C_build_mutant");
+    SEXP src_ref = getSrcRefs(exprs);
+    const ValidationMode mode = MutantValidator::modeFromR(validate);
+    if (TYPEOF(sites) != VECSXP)
+        Rf_error("'sites' must be the table returned by C_mutation_sites.");
+    if (TYPEOF(site_id) != INTSXP || Rf_length(site_id) == 0)
+        Rf_error("'site_id' must be a non-empty integer vector.");
+
+    const int n_rows = Rf_length(site_id);
+    std::vector<int> rows(n_rows);
+    for (int k = 0; k < n_rows; ++k) {
+        rows[k] = INTEGER(site_id)[k] - 1;
+        if (rows[k] < 0)
+            Rf_error("Site %d is out of range.", rows[k] + 1);
+    }
+    AllocStats::buffer(rows);
+
+    const int row = rows[0];
+    const int i = siteColumn(sites, "expr_index", row) - 1;
+    const bool in_block = siteColumn(sites, "in_block", row) == TRUE;
+    if (i < 0 || i >= Rf_length(exprs))
+        Rf_error("Site %d refers to a missing expression.", row + 1);
+
+    SEXP cur_expr = VECTOR_ELT(exprs, i);
+    ASTHandler astHandler;
+    SiteTable ops =
+        astHandler.gatherOperators(cur_expr, VECTOR_ELT(src_ref, i), in_block);
+
+    std::vector<int> which;
+    for (int r : rows) {
+        if (siteColumn(sites, "expr_index", r) - 1 != i)
+            Rf_error("Sites %d and %d are in different expressions.", row + 1, r + 1);
+        const int j = siteColumn(sites, "op_index", r) - 1;
+        if (j < 0 || j >= ops.size())
+            Rf_error("Site %d does not match the parsed file.", r + 1);
+
+        // the table already holds the token positions; reuse them rather than
+        // indexing the parse data again for a few sites
+        ops.start_line[j] = siteColumn(sites, "start_line", r);
+        ops.start_col[j]  = siteColumn(sites, "start_col", r);
+        ops.end_line[j]   = siteColumn(sites, "end_line", r);
+        ops.end_col[j]    = siteColumn(sites, "end_col", r);
+        which.push_back(j);
+    }
+
+    Mutator mutator;
+    auto result = mutator.applyMutations(cur_expr, ops, which);
+    if (!result.second)
+        return scope.done(R_NilValue);
+
+    // result.first is left protected by the mutator
+    SEXP res = isValidMutant(exprs, i, result.first, mode) ? makeMutantDelta(i, result.first)
+                                                           : R_NilValue;
+    if (res != R_NilValue && TYPEOF(hashes) == RAWSXP &&
+        static_cast<size_t>(Rf_xlength(hashes)) == (Rf_length(exprs) + 1) * sizeof(std::uint64_t)) {
+        PROTECT(res);
+        std::uint64_t program, old_hash;
+        std::memcpy(&program, RAW(hashes), sizeof(program));
+        std::memcpy(&old_hash, RAW(hashes) + (i + 1) * sizeof(std::uint64_t), sizeof(old_hash));
+        AstHasher hasher;
+        setHashAttrib(res, AstHasher::substitute(program, i, old_hash, hasher.hash(result.first)));
+        UNPROTECT(1);
+    }
+    UNPROTECT(1);
+    return scope.done(res);
+}
+
+// Switch allocation counting on or off (a NULL `enable` leaves it as it is),
+// optionally zero the counts, and return them
+extern "C" SEXP C_alloc_counters(SEXP enable, SEXP reset)
+{
+    if (enable != R_NilValue) {
+        if (!Rf_isLogical(enable) || Rf_length(enable) != 1 || LOGICAL(enable)[0] == NA_LOGICAL)
+            Rf_error("'enable' must be TRUE, FALSE or NULL.");
+        AllocStats::enable(LOGICAL(enable)[0]);
+    }
+    if (Rf_asLogical(reset) == TRUE)
+        AllocStats::reset();
+    return AllocStats::toR();
+}